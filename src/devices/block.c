@@ -3,7 +3,15 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/iosched.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Most requests merged into a single command. */
+#define MERGE_MAX 64
 
 /* A block device. */
 struct block
@@ -17,8 +25,23 @@ struct block
     const struct block_operations *ops;  /* Driver operations. */
     void *aux;                          /* Extra data owned by driver. */
 
-    unsigned long long read_cnt;        /* Number of sectors read. */
-    unsigned long long write_cnt;       /* Number of sectors written. */
+    /* A slice of another device, such as a partition, has no
+       operations or queue of its own.  Its requests go straight
+       to PARENT, offset by START sectors. */
+    struct block *parent;               /* Underlying device, if any. */
+    block_sector_t start;               /* First sector within PARENT. */
+
+    /* Requests waiting for the dispatch thread.  Protected by
+       disabling interrupts. */
+    struct iosched sched;
+    struct semaphore queue_cnt;         /* Number of queued requests. */
+    bool dispatching;                   /* Dispatch thread started? */
+    struct thread *dispatcher;          /* Dispatch thread, once running. */
+
+    /* Statistics.  Protected by disabling interrupts, so that
+       block_get_stats() sees a consistent snapshot. */
+    struct iostat stats;
+    unsigned depth;                     /* Requests outstanding. */
   };
 
 /* List of all block devices. */
@@ -28,6 +51,20 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static struct block *register_block (const char *name, enum block_type,
+                                     const char *extra_info,
+                                     block_sector_t size);
+static void sync_transfer (struct block *, block_sector_t, void *,
+                           size_t cnt, bool write);
+static block_done_func wake_waiter;
+static struct block *route (struct block *, struct block_request *);
+static thread_func dispatch;
+static void run_requests (struct block *, struct block_request **,
+                          size_t cnt);
+static void account_submit (struct block *);
+static void account_done (struct block *, const struct block_request *,
+                          uint64_t start, uint64_t end);
+static void print_stats (struct block *);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -99,17 +136,18 @@ block_get_by_name (const char *name)
   return NULL;
 }
 
-/* Verifies that SECTOR is a valid offset within BLOCK.
-   Panics if not. */
+/* Verifies that the CNT sectors starting at SECTOR lie within
+   BLOCK.  Panics if not. */
 static void
-check_sector (struct block *block, block_sector_t sector)
+check_sectors (struct block *block, block_sector_t sector, size_t cnt)
 {
-  if (sector >= block->size)
+  if (sector >= block->size || cnt > block->size - sector)
     {
       /* We do not use ASSERT because we want to panic here
          regardless of whether NDEBUG is defined. */
-      PANIC ("Access past end of device %s (sector=%"PRDSNu", "
-             "size=%"PRDSNu")\n", block_name (block), sector, block->size);
+      PANIC ("Access past end of device %s (sector=%"PRDSNu", cnt=%zu, "
+             "size=%"PRDSNu")\n", block_name (block), sector, cnt,
+             block->size);
     }
 }
 
@@ -120,9 +158,7 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
-  check_sector (block, sector);
-  block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  sync_transfer (block, sector, buffer, 1, false);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -133,10 +169,254 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
-  check_sector (block, sector);
-  ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  sync_transfer (block, sector, (void *) buffer, 1, true);
+}
+
+/* Reads the CNT sectors starting at SECTOR from BLOCK into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes, in as few commands as the driver allows. */
+void
+block_read_sectors (struct block *block, block_sector_t sector,
+                    void *buffer, size_t cnt)
+{
+  sync_transfer (block, sector, buffer, cnt, false);
+}
+
+/* Writes the CNT sectors starting at SECTOR to BLOCK from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes, in
+   as few commands as the driver allows.  Returns after the
+   device has acknowledged receiving the data. */
+void
+block_write_sectors (struct block *block, block_sector_t sector,
+                     const void *buffer, size_t cnt)
+{
+  sync_transfer (block, sector, (void *) buffer, cnt, true);
+}
+
+/* Queues request R on BLOCK and returns without waiting for it.
+   R->done is called from BLOCK's dispatch thread once the
+   transfer is complete.  Requests to a device are carried out in
+   the order chosen by its I/O scheduler.  The first request to a device
+   starts its dispatch thread, so this function must not be
+   called from an interrupt handler. */
+void
+block_submit (struct block *block, struct block_request *r)
+{
+  enum intr_level old_level;
+  bool start;
+
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  block = route (block, r);
+  iosched_add (&block->sched, r);
+  start = !block->dispatching;
+  block->dispatching = true;
+  intr_set_level (old_level);
+  sema_up (&block->queue_cnt);
+
+  if (start && thread_create (block->name, PRI_MAX, dispatch, block)
+               == TID_ERROR)
+    PANIC ("%s: can't create dispatch thread", block->name);
+}
+
+/* Checks request R, submitted to BLOCK, and follows BLOCK's
+   chain of slices down to the device with a driver, rebasing
+   R->sector along the way.  Returns that device.  Interrupts
+   must be off. */
+static struct block *
+route (struct block *block, struct block_request *r)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (r->cnt >= 1 && r->cnt <= BLOCK_TRANSFER_MAX);
+  ASSERT (r->done != NULL);
+
+  r->origin = block;
+  r->submitted = timer_cycles ();
+  for (;;)
+    {
+      check_sectors (block, r->sector, r->cnt);
+      ASSERT (!r->write || block->type != BLOCK_FOREIGN);
+      block->stats.dir[r->write].sector_cnt += r->cnt;
+      if (block->parent == NULL)
+        break;
+      r->sector += block->start;
+      block = block->parent;
+    }
+  account_submit (block);
+  if (r->origin != block)
+    account_submit (r->origin);
+  return block;
+}
+
+/* Reads or writes the CNT sectors starting at SECTOR on BLOCK
+   through the request queue, at most BLOCK_TRANSFER_MAX at a
+   time, and waits for the transfer to finish.
+
+   The device's own dispatch thread, which may get here from a
+   completion function, cannot wait for itself to serve the
+   request, so it calls the driver directly instead. */
+static void
+sync_transfer (struct block *block, block_sector_t sector, void *buffer,
+               size_t cnt, bool write)
+{
+  struct block_request r;
+  struct semaphore done;
+  struct block *root;
+
+  for (root = block; root->parent != NULL; root = root->parent)
+    continue;
+
+  sema_init (&done, 0);
+  while (cnt > 0)
+    {
+      r.write = write;
+      r.sector = sector;
+      r.cnt = cnt < BLOCK_TRANSFER_MAX ? cnt : BLOCK_TRANSFER_MAX;
+      r.buffer = buffer;
+      r.done = wake_waiter;
+      r.aux = &done;
+      if (root->dispatcher == thread_current ())
+        {
+          enum intr_level old_level = intr_disable ();
+          struct block_request *run = &r;
+
+          route (block, &r);
+          intr_set_level (old_level);
+          run_requests (root, &run, 1);
+        }
+      else
+        block_submit (block, &r);
+      sema_down (&done);
+
+      sector += r.cnt;
+      buffer = (uint8_t *) buffer + r.cnt * BLOCK_SECTOR_SIZE;
+      cnt -= r.cnt;
+    }
+}
+
+/* Completion function for sync_transfer(). */
+static void
+wake_waiter (struct block_request *r UNUSED, void *done)
+{
+  sema_up (done);
+}
+
+/* Dispatch thread for BLOCK_.  Takes requests from the I/O
+   scheduler and hands them to the driver, merging requests for
+   consecutive sectors into one command if the driver has a
+   transfer operation. */
+static void
+dispatch (void *block_)
+{
+  struct block *block = block_;
+
+  block->dispatcher = thread_current ();
+  for (;;)
+    {
+      struct block_request *run[MERGE_MAX];
+      enum intr_level old_level;
+      size_t cnt, sector_cnt;
+
+      sema_down (&block->queue_cnt);
+      old_level = intr_disable ();
+      run[0] = iosched_next (&block->sched);
+      sector_cnt = run[0]->cnt;
+      for (cnt = 1; cnt < MERGE_MAX && block->ops->transfer != NULL; cnt++)
+        {
+          run[cnt] = iosched_merge (&block->sched, run[cnt - 1],
+                                    BLOCK_TRANSFER_MAX - sector_cnt);
+          if (run[cnt] == NULL)
+            break;
+          sector_cnt += run[cnt]->cnt;
+
+          /* Consume the merged request's count as well. */
+          if (!sema_try_down (&block->queue_cnt))
+            NOT_REACHED ();
+        }
+      intr_set_level (old_level);
+
+      run_requests (block, run, cnt);
+    }
+}
+
+/* Hands the CNT requests in RUN, already routed to BLOCK, to its
+   driver, as one command if the driver has a transfer operation
+   (in which case they must be for consecutive sectors), and then
+   reports their completion. */
+static void
+run_requests (struct block *block, struct block_request **run, size_t cnt)
+{
+  enum intr_level old_level;
+  size_t command_cnt, i;
+  uint64_t start, end;
+
+  start = timer_cycles ();
+  if (block->ops->transfer != NULL)
+    {
+      block->ops->transfer (block->aux, run, cnt);
+      command_cnt = 1;
+    }
+  else
+    {
+      ASSERT (cnt == 1);
+      for (i = 0; i < run[0]->cnt; i++)
+        {
+          uint8_t *buffer = run[0]->buffer;
+          buffer += i * BLOCK_SECTOR_SIZE;
+          if (run[0]->write)
+            block->ops->write (block->aux, run[0]->sector + i, buffer);
+          else
+            block->ops->read (block->aux, run[0]->sector + i, buffer);
+        }
+      command_cnt = run[0]->cnt;
+    }
+  end = timer_cycles ();
+
+  old_level = intr_disable ();
+  block->stats.command_cnt += command_cnt;
+  for (i = 0; i < cnt; i++)
+    {
+      account_done (block, run[i], start, end);
+      if (run[i]->origin != block)
+        account_done (run[i]->origin, run[i], start, end);
+    }
+  intr_set_level (old_level);
+
+  for (i = 0; i < cnt; i++)
+    run[i]->done (run[i], run[i]->aux);
+}
+
+/* Records the submission of a request to BLOCK.  Interrupts
+   must be off. */
+static void
+account_submit (struct block *block)
+{
+  block->depth++;
+  if (block->depth > block->stats.max_depth)
+    block->stats.max_depth = block->depth;
+  block->stats.depth_sum += block->depth;
+}
+
+/* Records the completion of R on BLOCK, where the driver started
+   on R at time START and finished at END.  Interrupts must be
+   off. */
+static void
+account_done (struct block *block, const struct block_request *r,
+              uint64_t start, uint64_t end)
+{
+  struct iostat_dir *dir = &block->stats.dir[r->write];
+  uint64_t latency = end - r->submitted;
+  int bucket;
+
+  for (bucket = 0; bucket < IOSTAT_BUCKETS - 1 && latency > 1; bucket++)
+    latency >>= 1;
+
+  dir->request_cnt++;
+  dir->queue_cycles += start - r->submitted;
+  dir->service_cycles += end - start;
+  dir->latency[bucket]++;
+  block->depth--;
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -160,22 +440,73 @@ block_type (struct block *block)
   return block->type;
 }
 
-/* Prints statistics for each block device used for a Pintos role. */
+/* Prints statistics for each block device that has been used. */
 void
 block_print_stats (void)
 {
-  int i;
+  struct list_elem *e;
 
-  for (i = 0; i < BLOCK_ROLE_CNT; i++)
+  for (e = list_begin (&all_blocks); e != list_end (&all_blocks);
+       e = list_next (e))
+    print_stats (list_entry (e, struct block, list_elem));
+}
+
+/* Copies BLOCK's statistics into STATS. */
+void
+block_get_stats (struct block *block, struct iostat *stats)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  *stats = block->stats;
+  intr_set_level (old_level);
+
+  strlcpy (stats->name, block->name, sizeof stats->name);
+  strlcpy (stats->type, block_type_name (block->type), sizeof stats->type);
+}
+
+/* Prints BLOCK's statistics, if it has been used. */
+static void
+print_stats (struct block *block)
+{
+  static const char *dir_names[2] = {"read", "write"};
+  struct iostat stats;
+  uint64_t request_cnt;
+  int i, j;
+
+  block_get_stats (block, &stats);
+  request_cnt = stats.dir[0].request_cnt + stats.dir[1].request_cnt;
+  if (stats.dir[0].sector_cnt + stats.dir[1].sector_cnt == 0)
+    return;
+
+  printf ("%s (%s): %llu reads, %llu writes\n",
+          stats.name, stats.type,
+          stats.dir[0].sector_cnt, stats.dir[1].sector_cnt);
+  for (i = 0; i < 2; i++)
     {
-      struct block *block = block_by_role[i];
-      if (block != NULL)
-        {
-          printf ("%s (%s): %llu reads, %llu writes\n",
-                  block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
-        }
+      const struct iostat_dir *dir = &stats.dir[i];
+      if (dir->request_cnt == 0)
+        continue;
+
+      printf ("  %ss: %llu requests, average %llu cycles queued, "
+              "%llu cycles in service\n", dir_names[i], dir->request_cnt,
+              dir->queue_cycles / dir->request_cnt,
+              dir->service_cycles / dir->request_cnt);
+      printf ("  %s latency (log2 cycles: requests):", dir_names[i]);
+      for (j = 0; j < IOSTAT_BUCKETS; j++)
+        if (dir->latency[j] != 0)
+          printf (" %d: %"PRIu32, j, dir->latency[j]);
+      printf ("\n");
     }
+  if (request_cnt != 0)
+    printf ("  queue depth: %"PRIu32" maximum, %llu.%02llu average\n",
+            stats.max_depth, stats.depth_sum / request_cnt,
+            stats.depth_sum * 100 / request_cnt % 100);
+  if (stats.lock_cnt != 0)
+    printf ("  channel lock: %llu acquisitions, %llu contended, "
+            "average %llu cycles waiting\n",
+            stats.lock_cnt, stats.lock_contended_cnt,
+            stats.lock_wait_cycles / stats.lock_cnt);
 }
 
 /* Registers a new block device with the given NAME.  If
@@ -187,6 +518,52 @@ struct block *
 block_register (const char *name, enum block_type type,
                 const char *extra_info, block_sector_t size,
                 const struct block_operations *ops, void *aux)
+{
+  struct block *block = register_block (name, type, extra_info, size);
+  block->ops = ops;
+  block->aux = aux;
+  return block;
+}
+
+/* Registers a new block device with the given NAME, TYPE, and
+   EXTRA_INFO, like block_register(), that consists of the SIZE
+   sectors of PARENT starting at sector START. */
+struct block *
+block_register_slice (const char *name, enum block_type type,
+                      const char *extra_info, block_sector_t size,
+                      struct block *parent, block_sector_t start)
+{
+  struct block *block;
+
+  ASSERT (start <= parent->size && size <= parent->size - start);
+
+  block = register_block (name, type, extra_info, size);
+  block->parent = parent;
+  block->start = start;
+  return block;
+}
+
+/* Records that BLOCK's driver waited CYCLES to acquire the lock
+   on the controller shared with other devices, and whether it
+   found the lock held. */
+void
+block_note_lock_wait (struct block *block, uint64_t cycles, bool contended)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  block->stats.lock_cnt++;
+  if (contended)
+    block->stats.lock_contended_cnt++;
+  block->stats.lock_wait_cycles += cycles;
+  intr_set_level (old_level);
+}
+
+/* Allocates and announces a block device without operations,
+   for block_register() and block_register_slice() to fill in. */
+static struct block *
+register_block (const char *name, enum block_type type,
+                const char *extra_info, block_sector_t size)
 {
   struct block *block = malloc (sizeof *block);
   if (block == NULL)
@@ -196,10 +573,16 @@ block_register (const char *name, enum block_type type,
   strlcpy (block->name, name, sizeof block->name);
   block->type = type;
   block->size = size;
-  block->ops = ops;
-  block->aux = aux;
-  block->read_cnt = 0;
-  block->write_cnt = 0;
+  block->ops = NULL;
+  block->aux = NULL;
+  block->parent = NULL;
+  block->start = 0;
+  iosched_init (&block->sched);
+  sema_init (&block->queue_cnt, 0);
+  block->dispatching = false;
+  block->dispatcher = NULL;
+  memset (&block->stats, 0, sizeof block->stats);
+  block->depth = 0;
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
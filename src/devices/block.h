@@ -3,6 +3,8 @@
 
 #include <stddef.h>
 #include <inttypes.h>
+#include <iostat.h>
+#include <list.h>
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -14,6 +16,9 @@
    Good enough for devices up to 2 TB. */
 typedef uint32_t block_sector_t;
 
+/* Most sectors transferred by a single request or command. */
+#define BLOCK_TRANSFER_MAX 256
+
 /* Format specifier for printf(), e.g.:
    printf ("sector=%"PRDSNu"\n", sector); */
 #define PRDSNu PRIu32
@@ -53,11 +58,42 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_read_sectors (struct block *, block_sector_t, void *, size_t cnt);
+void block_write_sectors (struct block *, block_sector_t, const void *,
+                          size_t cnt);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
+/* Asynchronous requests. */
+struct block_request;
+typedef void block_done_func (struct block_request *, void *aux);
+
+/* A request to read or write CNT consecutive sectors.  The
+   submitter owns the request and its buffer, which must stay
+   valid until DONE is called.  DONE runs in the device's dispatch thread, so it
+   should not block for long. */
+struct block_request
+  {
+    bool write;                 /* True to write, false to read. */
+    block_sector_t sector;      /* Sector, rebased by the block layer. */
+    size_t cnt;                 /* 1 to BLOCK_TRANSFER_MAX sectors. */
+    void *buffer;               /* CNT * BLOCK_SECTOR_SIZE bytes. */
+    block_done_func *done;      /* Called when the transfer is over. */
+    void *aux;                  /* Passed to DONE. */
+
+    /* Owned by the block layer and the I/O scheduler. */
+    struct block *origin;       /* Device submitted to. */
+    uint64_t submitted;         /* Time of submission, in cycles. */
+    struct list_elem elem;      /* Element in a device's queue. */
+    struct list_elem fifo_elem; /* Element in a queue by arrival. */
+    int64_t deadline;           /* Tick by which to serve request. */
+  };
+
+void block_submit (struct block *, struct block_request *);
+
 /* Statistics. */
 void block_print_stats (void);
+void block_get_stats (struct block *, struct iostat *);
 
 /* Lower-level interface to block device drivers. */
 
@@ -65,10 +101,23 @@ struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+
+    /* Optional.  Carries out the CNT requests in REQS, which are
+       all reads or all writes of consecutive sectors starting at
+       REQS[0]->sector, at most BLOCK_TRANSFER_MAX in all, as a
+       single command.  If present, used
+       for every request instead of READ and WRITE. */
+    void (*transfer) (void *aux, struct block_request **reqs, size_t cnt);
   };
 
 struct block *block_register (const char *name, enum block_type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *, void *aux);
+struct block *block_register_slice (const char *name, enum block_type,
+                                    const char *extra_info,
+                                    block_sector_t size,
+                                    struct block *parent,
+                                    block_sector_t start);
+void block_note_lock_wait (struct block *, uint64_t cycles, bool contended);
 
 #endif /* devices/block.h */
@@ -9,9 +9,19 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   If the channels belong to a PCI IDE controller capable of bus
+   mastering, as the PIIX controllers emulated by QEMU and Bochs
+   are, sectors are transferred by DMA, without the CPU copying
+   each word through the data register.  Otherwise, or if DMA
+   fails, programmed I/O is used. */
+
+/* If false, never use DMA. */
+bool ide_use_dma = true;
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -30,10 +40,25 @@
 #define reg_ctl(CHANNEL) ((CHANNEL)->reg_base + 0x206)  /* Control (w/o). */
 #define reg_alt_status(CHANNEL) reg_ctl (CHANNEL)       /* Alt Status (r/o). */
 
+/* Bus master IDE port addresses. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRD table. */
+
 /* Alternate Status Register bits. */
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
+
+/* Bus Master Command Register bits. */
+#define BMC_START 0x01          /* Start transfer. */
+#define BMC_READ 0x08           /* Transfer from disk to memory. */
+
+/* Bus Master Status Register bits. */
+#define BMS_ACTIVE 0x01         /* Transfer in progress. */
+#define BMS_ERROR 0x02          /* Transfer failed. */
+#define BMS_INTR 0x04           /* Disk has interrupted. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +74,26 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Physical region descriptor: one physically contiguous piece of
+   memory to transfer by DMA.  A region must not cross a 64 kB
+   boundary. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address. */
+    uint16_t size;              /* Size in bytes, 0 meaning 64 kB. */
+    uint16_t flags;             /* PRD_EOT on the last descriptor. */
+  };
+#define PRD_EOT 0x8000          /* End of table. */
+
+/* Descriptors per channel.  Each table is aligned on its own
+   size, so that it does not cross a 64 kB boundary either. */
+#define PRD_CNT 128
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +102,9 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    bool dma;                   /* Transfer sectors by DMA? */
+    int multiple;               /* Sectors per PIO interrupt. */
+    struct block *block;        /* Registered block device. */
   };
 
 /* An ATA channel (aka controller).
@@ -72,21 +120,33 @@ struct channel
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+    uint16_t bm_base;           /* Bus master base port, or 0. */
+    struct prd *prdt;           /* Table of regions for DMA. */
+
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
 
 /* We support the two "legacy" ATA channels found in a standard PC. */
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
+static struct prd prd_tables[CHANNEL_CNT][PRD_CNT]
+  __attribute__ ((aligned (PRD_CNT * sizeof (struct prd))));
 
 static struct block_operations ide_operations;
 
+static uint16_t find_bus_master (void);
 static void reset_channel (struct channel *);
+static void recover_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
+static void set_multiple_mode (struct ata_disk *, int max);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static void select_sector (struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
+static void pio_transfer (struct ata_disk *, struct block_request **,
+                          size_t cnt);
+static bool dma_transfer (struct ata_disk *, struct block_request **,
+                          size_t cnt);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
 
@@ -101,6 +161,7 @@ static void interrupt_handler (struct intr_frame *);
 void
 ide_init (void) 
 {
+  uint16_t bm_base = ide_use_dma ? find_bus_master () : 0;
   size_t chan_no;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
@@ -126,6 +187,8 @@ ide_init (void)
       lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      c->bm_base = bm_base != 0 ? bm_base + chan_no * 8 : 0;
+      c->prdt = prd_tables[chan_no];
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,6 +199,9 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->dma = false;
+          d->multiple = 1;
+          d->block = NULL;
         }
 
       /* Register interrupt handler. */
@@ -221,6 +287,30 @@ reset_channel (struct channel *c)
     }
 }
 
+/* Resets channel C after a failed command, which may have left a
+   disk in the middle of the command or still asserting DRQ.  A
+   reset may also return each disk's READ MULTIPLE and WRITE
+   MULTIPLE block size to its default, so sets those up again.
+   C must be locked. */
+static void
+recover_channel (struct channel *c)
+{
+  int dev_no;
+
+  reset_channel (c);
+  for (dev_no = 0; dev_no < 2; dev_no++)
+    {
+      struct ata_disk *d = &c->devices[dev_no];
+      int multiple = d->multiple;
+
+      if (d->is_ata)
+        {
+          d->multiple = 1;
+          set_multiple_mode (d, multiple);
+        }
+    }
+}
+
 /* Checks whether device D is an ATA disk and sets D's is_ata
    member appropriately.  If D is device 0 (master), returns true
    if it's possible that a slave (device 1) exists on this
@@ -286,8 +376,11 @@ identify_ata_device (struct ata_disk *d)
   capacity = *(uint32_t *) &id[60 * 2];
   model = descramble_ata_string (&id[10 * 2], 20);
   serial = descramble_ata_string (&id[27 * 2], 40);
+  d->dma = c->bm_base != 0 && (*(uint16_t *) &id[49 * 2] & (1 << 8));
+  set_multiple_mode (d, (uint8_t) id[47 * 2]);
   snprintf (extra_info, sizeof extra_info,
-            "model \"%s\", serial \"%s\"", model, serial);
+            "model \"%s\", serial \"%s\"%s", model, serial,
+            d->dma ? ", DMA" : "");
 
   /* Disable access to IDE disks over 1 GB, which are likely
      physical IDE disks rather than virtual ones.  If we don't
@@ -306,9 +399,35 @@ identify_ata_device (struct ata_disk *d)
   /* Register. */
   block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
                           &ide_operations, d);
+  d->block = block;
   partition_scan (block);
 }
 
+/* Tries to have disk D transfer up to MAX sectors per interrupt
+   in READ MULTIPLE and WRITE MULTIPLE commands, where MAX comes
+   from the IDENTIFY DEVICE data.  Leaves D transferring one
+   sector per interrupt if MAX is 0 or the disk refuses. */
+static void
+set_multiple_mode (struct ata_disk *d, int max)
+{
+  struct channel *c = d->channel;
+  int multiple;
+
+  /* Only powers of 2 are valid. */
+  for (multiple = 1; multiple * 2 <= max; multiple *= 2)
+    continue;
+  if (multiple < 2)
+    return;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), multiple);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if (!(inb (reg_alt_status (c)) & STA_ERR))
+    d->multiple = multiple;
+}
+
 /* Translates STRING, which consists of SIZE bytes in a funky
    format, into a null-terminated string in-place.  Drops
    trailing whitespace and null bytes.  Returns STRING.  */
@@ -347,7 +466,7 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
+  select_sector (d, sec_no, 1);
   issue_pio_command (c, CMD_READ_SECTOR_RETRY);
   sema_down (&c->completion_wait);
   if (!wait_while_busy (d))
@@ -367,7 +486,7 @@ ide_write (void *d_, block_sector_t sec_no, const void *buffer)
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
+  select_sector (d, sec_no, 1);
   issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
   if (!wait_while_busy (d))
     PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
@@ -376,24 +495,180 @@ ide_write (void *d_, block_sector_t sec_no, const void *buffer)
   lock_release (&c->lock);
 }
 
+/* Carries out the CNT requests in REQS, which are all reads or
+   all writes of consecutive sectors on disk D, with a single
+   command, by DMA if possible.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_transfer (void *d_, struct block_request **reqs, size_t cnt)
+{
+  struct ata_disk *d = d_;
+  struct channel *c = d->channel;
+  uint64_t start = timer_cycles ();
+  bool contended;
+
+  contended = !lock_try_acquire (&c->lock);
+  if (contended)
+    lock_acquire (&c->lock);
+  block_note_lock_wait (d->block, timer_cycles () - start, contended);
+
+  if (!d->dma || !dma_transfer (d, reqs, cnt))
+    pio_transfer (d, reqs, cnt);
+  lock_release (&c->lock);
+}
+
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_transfer
   };
+
+/* Carries out the CNT requests in REQS on disk D, as
+   ide_transfer(), by programmed I/O.  The disk interrupts once
+   per block of D->multiple sectors, when it has a block ready
+   for a read or has taken a block for a write.  D's channel must
+   be locked. */
+static void
+pio_transfer (struct ata_disk *d, struct block_request **reqs, size_t cnt)
+{
+  struct channel *c = d->channel;
+  bool write = reqs[0]->write;
+  block_sector_t sec_no = reqs[0]->sector;
+  size_t sector_cnt, i;
+  size_t r, ofs;                /* Position in REQS. */
+
+  sector_cnt = 0;
+  for (r = 0; r < cnt; r++)
+    sector_cnt += reqs[r]->cnt;
+
+  select_sector (d, sec_no, sector_cnt);
+  if (d->multiple > 1)
+    issue_pio_command (c, write ? CMD_WRITE_MULTIPLE : CMD_READ_MULTIPLE);
+  else
+    issue_pio_command (c, (write
+                           ? CMD_WRITE_SECTOR_RETRY
+                           : CMD_READ_SECTOR_RETRY));
+
+  r = ofs = 0;
+  for (i = 0; i < sector_cnt; i++)
+    {
+      uint8_t *buffer = (uint8_t *) reqs[r]->buffer + ofs;
+      bool block_start = i % d->multiple == 0;
+      bool block_end = (i + 1) % d->multiple == 0 || i + 1 == sector_cnt;
+
+      if (!write)
+        {
+          if (block_start)
+            {
+              sema_down (&c->completion_wait);
+              if (!wait_while_busy (d))
+                PANIC ("%s: disk read failed, sector=%"PRDSNu,
+                       d->name, sec_no + i);
+            }
+          input_sector (c, buffer);
+        }
+      else
+        {
+          if (block_start && !wait_while_busy (d))
+            PANIC ("%s: disk write failed, sector=%"PRDSNu,
+                   d->name, sec_no + i);
+          output_sector (c, buffer);
+          if (block_end)
+            sema_down (&c->completion_wait);
+        }
+
+      ofs += BLOCK_SECTOR_SIZE;
+      if (ofs == reqs[r]->cnt * BLOCK_SECTOR_SIZE)
+        {
+          r++;
+          ofs = 0;
+        }
+    }
+}
+
+/* Carries out the CNT requests in REQS on disk D, as
+   ide_transfer(), by DMA, with a single interrupt at the end.
+   D's channel must be locked.  Returns true if successful.
+   Returns false without touching the disk if the buffers need
+   more descriptors than fit in the table.  If the transfer
+   fails, turns off DMA for D, resets the channel so that the
+   caller can retry by PIO, and returns false. */
+static bool
+dma_transfer (struct ata_disk *d, struct block_request **reqs, size_t cnt)
+{
+  struct channel *c = d->channel;
+  uint8_t direction = reqs[0]->write ? 0 : BMC_READ;
+  uint8_t bm_status, status;
+  size_t prd_cnt = 0;
+  size_t sector_cnt = 0;
+  size_t i;
+
+  /* Describe each buffer, splitting it where it crosses a 64 kB
+     boundary. */
+  for (i = 0; i < cnt; i++)
+    {
+      uintptr_t addr = vtop (reqs[i]->buffer);
+      size_t left = reqs[i]->cnt * BLOCK_SECTOR_SIZE;
+
+      sector_cnt += reqs[i]->cnt;
+      while (left > 0)
+        {
+          size_t size = 0x10000 - (addr & 0xffff);
+          if (size > left)
+            size = left;
+          if (prd_cnt >= PRD_CNT)
+            return false;
+          c->prdt[prd_cnt].addr = addr;
+          c->prdt[prd_cnt].size = size;
+          c->prdt[prd_cnt].flags = 0;
+          prd_cnt++;
+          addr += size;
+          left -= size;
+        }
+    }
+  c->prdt[prd_cnt - 1].flags = PRD_EOT;
+
+  /* Program the bus master, clearing any stale status, and
+     start the transfer. */
+  outl (reg_bm_prdt (c), vtop (c->prdt));
+  outb (reg_bm_command (c), direction);
+  outb (reg_bm_status (c), inb (reg_bm_status (c)) | BMS_ERROR | BMS_INTR);
+  select_sector (d, reqs[0]->sector, sector_cnt);
+  issue_pio_command (c, reqs[0]->write ? CMD_WRITE_DMA : CMD_READ_DMA);
+  outb (reg_bm_command (c), direction | BMC_START);
+
+  /* Wait for the disk to interrupt, then stop the bus master. */
+  sema_down (&c->completion_wait);
+  outb (reg_bm_command (c), direction);
+  bm_status = inb (reg_bm_status (c));
+  outb (reg_bm_status (c), bm_status | BMS_ERROR | BMS_INTR);
+  status = inb (reg_alt_status (c));
+  if ((bm_status & (BMS_ERROR | BMS_ACTIVE)) || (status & (STA_ERR | STA_DRQ)))
+    {
+      printf ("%s: DMA failed, sector=%"PRDSNu", switching to PIO\n",
+              d->name, reqs[0]->sector);
+      d->dma = false;
+      recover_channel (c);
+      return false;
+    }
+  return true;
+}
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and CNT, which must be between 1 and 256, to the
+   disk's sector selection registers.  (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
-  ASSERT (sec_no < (1UL << 28));
+  ASSERT (sec_no + cnt <= (1UL << 28));
+  ASSERT (cnt >= 1 && cnt <= 256);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt);            /* 0 means 256. */
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -402,7 +677,7 @@ select_sector (struct ata_disk *d, block_sector_t sec_no)
 }
 
 /* Writes COMMAND to channel C and prepares for receiving a
-   completion interrupt. */
+   completion interrupt.  Also used for DMA commands. */
 static void
 issue_pio_command (struct channel *c, uint8_t command) 
 {
@@ -432,6 +707,66 @@ output_sector (struct channel *c, const void *sector)
 
 /* Low-level ATA primitives. */
 
+/* PCI configuration space ports. */
+#define PCI_CONFIG_ADDR 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+
+/* Returns the configuration register at offset REG of PCI
+   function FUNC of device DEV on bus 0. */
+static uint32_t
+pci_read_config (int dev, int func, int reg)
+{
+  outl (PCI_CONFIG_ADDR, 0x80000000 | (dev << 11) | (func << 8) | reg);
+  return inl (PCI_CONFIG_DATA);
+}
+
+/* Writes DATA to the configuration register at offset REG of
+   PCI function FUNC of device DEV on bus 0. */
+static void
+pci_write_config (int dev, int func, int reg, uint32_t data)
+{
+  outl (PCI_CONFIG_ADDR, 0x80000000 | (dev << 11) | (func << 8) | reg);
+  outl (PCI_CONFIG_DATA, data);
+}
+
+/* Looks on PCI bus 0 for an IDE controller capable of bus
+   mastering.  If one is found, allows it to master the bus and
+   returns the first port of its bus master registers.
+   Otherwise, returns 0. */
+static uint16_t
+find_bus_master (void)
+{
+  int dev, func;
+
+  for (dev = 0; dev < 32; dev++)
+    for (func = 0; func < 8; func++)
+      {
+        uint32_t class, bar4, command;
+
+        if ((pci_read_config (dev, func, 0x00) & 0xffff) == 0xffff)
+          continue;
+
+        /* Class 01h, subclass 01h is IDE.  Bit 7 of the
+           programming interface means bus mastering. */
+        class = pci_read_config (dev, func, 0x08);
+        if ((class >> 16) != 0x0101 || !(class & 0x8000))
+          continue;
+
+        /* The bus master registers must be in I/O space. */
+        bar4 = pci_read_config (dev, func, 0x20);
+        if (!(bar4 & 1) || (bar4 & 0xfffc) == 0)
+          continue;
+
+        /* Enable I/O space and bus mastering.  The upper half of
+           the register is status, whose bits are cleared by
+           writing 1s, so write back zeros there. */
+        command = pci_read_config (dev, func, 0x04) & 0xffff;
+        pci_write_config (dev, func, 0x04, command | 0x05);
+        return bar4 & 0xfffc;
+      }
+  return 0;
+}
+
 /* Wait up to 10 seconds for the controller to become idle, that
    is, for the BSY and DRQ bits to clear in the status register.
 
@@ -0,0 +1,224 @@
+#include "devices/iosched.h"
+#include <debug.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+
+/* I/O scheduling.
+
+   Each queued request is in two lists: the queue, in the order
+   in which the policy wants to serve requests, and the FIFO for
+   its direction, in order of arrival.  The policies are:
+
+   - "noop": first come, first served.
+
+   - "clook": C-LOOK.  Serves requests in increasing order of
+     sector starting from the head position, then goes back to
+     the lowest queued sector, so the head sweeps across the
+     disk in one direction only.
+
+   - "deadline": C-LOOK, except that a request that has waited
+     past its deadline is served first, so that no request
+     starves.  Reads usually have a thread waiting for them, so
+     they expire sooner than writes.
+
+   Under every policy, a request that starts where one being
+   dispatched ends, in the same direction, may be merged into the
+   same command; see iosched_merge(). */
+
+/* How long a request may wait before the deadline policy serves
+   it out of order, in timer ticks. */
+#define READ_EXPIRE (TIMER_FREQ / 2)
+#define WRITE_EXPIRE (5 * TIMER_FREQ)
+
+/* An I/O scheduling policy. */
+struct iosched_policy
+  {
+    const char *name;
+
+    /* Adds a request to the queue. */
+    void (*add) (struct iosched *, struct block_request *);
+
+    /* Returns the request to serve next, without removing it.
+       The queue is not empty. */
+    struct block_request *(*next) (struct iosched *);
+  };
+
+static void fifo_add (struct iosched *, struct block_request *);
+static void sorted_add (struct iosched *, struct block_request *);
+static struct block_request *fifo_next (struct iosched *);
+static struct block_request *clook_next (struct iosched *);
+static struct block_request *deadline_next (struct iosched *);
+
+static const struct iosched_policy policies[] =
+  {
+    {"noop", fifo_add, fifo_next},
+    {"clook", sorted_add, clook_next},
+    {"deadline", sorted_add, deadline_next},
+  };
+#define POLICY_CNT (sizeof policies / sizeof *policies)
+
+/* Policy given to devices as they are registered. */
+static const struct iosched_policy *default_policy = &policies[2];
+
+static void dequeue (struct iosched *, struct block_request *);
+static list_less_func sector_less;
+
+/* Makes the policy called NAME the one used by devices
+   registered from now on.  Returns true if successful, false if
+   there is no such policy. */
+bool
+iosched_set_default (const char *name)
+{
+  size_t i;
+
+  for (i = 0; i < POLICY_CNT; i++)
+    if (!strcmp (name, policies[i].name))
+      {
+        default_policy = &policies[i];
+        return true;
+      }
+  return false;
+}
+
+/* Initializes S as an empty queue under the default policy. */
+void
+iosched_init (struct iosched *s)
+{
+  s->policy = default_policy;
+  list_init (&s->queue);
+  list_init (&s->fifo[0]);
+  list_init (&s->fifo[1]);
+  s->head = 0;
+}
+
+/* Adds R to S. */
+void
+iosched_add (struct iosched *s, struct block_request *r)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  r->deadline = timer_ticks () + (r->write ? WRITE_EXPIRE : READ_EXPIRE);
+  list_push_back (&s->fifo[r->write], &r->fifo_elem);
+  s->policy->add (s, r);
+}
+
+/* Removes and returns the request in S that should be served
+   next, or a null pointer if S is empty. */
+struct block_request *
+iosched_next (struct iosched *s)
+{
+  struct block_request *r;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (list_empty (&s->queue))
+    return NULL;
+  r = s->policy->next (s);
+  dequeue (s, r);
+  return r;
+}
+
+/* Removes and returns a request in S for at most MAX_CNT
+   sectors that continues PREV, that is, one in the same
+   direction that starts at the sector following PREV's last, or
+   returns a null pointer if there is none. */
+struct block_request *
+iosched_merge (struct iosched *s, const struct block_request *prev,
+               size_t max_cnt)
+{
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (e = list_begin (&s->queue); e != list_end (&s->queue);
+       e = list_next (e))
+    {
+      struct block_request *r = list_entry (e, struct block_request, elem);
+      if (r->write == prev->write && r->sector == prev->sector + prev->cnt
+          && r->cnt <= max_cnt)
+        {
+          dequeue (s, r);
+          return r;
+        }
+    }
+  return NULL;
+}
+
+/* Removes R from S and moves the head past it. */
+static void
+dequeue (struct iosched *s, struct block_request *r)
+{
+  list_remove (&r->elem);
+  list_remove (&r->fifo_elem);
+  s->head = r->sector + r->cnt;
+}
+
+/* Adds R at the end of S's queue. */
+static void
+fifo_add (struct iosched *s, struct block_request *r)
+{
+  list_push_back (&s->queue, &r->elem);
+}
+
+/* Adds R to S's queue in order of sector. */
+static void
+sorted_add (struct iosched *s, struct block_request *r)
+{
+  list_insert_ordered (&s->queue, &r->elem, sector_less, NULL);
+}
+
+/* Returns the request at the front of S's queue. */
+static struct block_request *
+fifo_next (struct iosched *s)
+{
+  return list_entry (list_front (&s->queue), struct block_request, elem);
+}
+
+/* Returns the first request in S at or past the head, or the
+   lowest-numbered request if there is none. */
+static struct block_request *
+clook_next (struct iosched *s)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&s->queue); e != list_end (&s->queue);
+       e = list_next (e))
+    {
+      struct block_request *r = list_entry (e, struct block_request, elem);
+      if (r->sector >= s->head)
+        return r;
+    }
+  return fifo_next (s);
+}
+
+/* Returns the oldest expired request in S, preferring reads, or
+   the request C-LOOK would choose if none has expired. */
+static struct block_request *
+deadline_next (struct iosched *s)
+{
+  int64_t now = timer_ticks ();
+  int write;
+
+  for (write = 0; write < 2; write++)
+    if (!list_empty (&s->fifo[write]))
+      {
+        struct block_request *r = list_entry (list_front (&s->fifo[write]),
+                                              struct block_request,
+                                              fifo_elem);
+        if (r->deadline <= now)
+          return r;
+      }
+  return clook_next (s);
+}
+
+/* Returns true if request A_ is for a lower sector than B_. */
+static bool
+sector_less (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED)
+{
+  const struct block_request *a = list_entry (a_, struct block_request, elem);
+  const struct block_request *b = list_entry (b_, struct block_request, elem);
+
+  return a->sector < b->sector;
+}
@@ -0,0 +1,28 @@
+#ifndef DEVICES_IOSCHED_H
+#define DEVICES_IOSCHED_H
+
+#include <list.h>
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* Queue of block requests waiting for a device, ordered by an
+   I/O scheduling policy.  All of the functions below must be
+   called with interrupts off. */
+struct iosched
+  {
+    const struct iosched_policy *policy;
+    struct list queue;          /* Requests in the policy's order. */
+    struct list fifo[2];        /* Reads and writes, oldest first. */
+    block_sector_t head;        /* Sector following the last served. */
+  };
+
+bool iosched_set_default (const char *name);
+
+void iosched_init (struct iosched *);
+void iosched_add (struct iosched *, struct block_request *);
+struct block_request *iosched_next (struct iosched *);
+struct block_request *iosched_merge (struct iosched *,
+                                     const struct block_request *,
+                                     size_t max_cnt);
+
+#endif /* devices/iosched.h */
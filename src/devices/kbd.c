@@ -7,6 +7,8 @@
 #include "devices/shutdown.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
 
 /* Keyboard data register port. */
 #define DATA_REG 0x60
@@ -24,12 +26,19 @@ static bool caps_lock;
 /* Number of keys pressed. */
 static int64_t key_cnt;
 
+/* Prints scheduling statistics on Ctrl+Alt+S.  The dump is
+   deferred to a worker thread, since it is too long to print
+   with interrupts off. */
+static struct work stats_work;
+
 static intr_handler_func keyboard_interrupt;
+static work_func print_thread_stats;
 
 /* Initializes the keyboard. */
 void
 kbd_init (void) 
 {
+  work_init (&stats_work, print_thread_stats, NULL);
   intr_register_ext (0x21, keyboard_interrupt, "8042 Keyboard");
 }
 
@@ -137,6 +146,10 @@ keyboard_interrupt (struct intr_frame *args UNUSED)
           if (c == 0177 && ctrl && alt)
             shutdown_reboot ();
 
+          /* Dump scheduling statistics if Ctrl+Alt+S pressed. */
+          if (c == 'S' && ctrl && alt)
+            work_submit (&stats_work, WORK_PRI_NORMAL);
+
           /* Handle Ctrl, Shift.
              Note that Ctrl overrides Shift. */
           if (ctrl && c >= 0x40 && c < 0x60) 
@@ -211,3 +224,10 @@ map_key (const struct keymap k[], unsigned scancode, uint8_t *c)
 
   return false;
 }
+
+/* Prints scheduling statistics, from a worker thread. */
+static void
+print_thread_stats (void *aux UNUSED)
+{
+  thread_print_stats ();
+}
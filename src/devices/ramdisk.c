@@ -0,0 +1,119 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A block device whose sectors are kept in pages from the kernel
+   pool.  The pages need not be contiguous, so a large disk can
+   be created even when memory is fragmented.  Its contents do
+   not survive a reboot. */
+
+/* Sectors per page. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A RAM disk may take at most 1/RESERVE_DIV of the kernel pool's
+   free pages, leaving the rest for the kernel itself. */
+#define RESERVE_DIV 4
+
+/* A RAM disk. */
+struct ramdisk
+  {
+    uint8_t **pages;            /* Pages holding the sectors, in order. */
+    size_t page_cnt;            /* Number of pages. */
+  };
+
+static struct block_operations ramdisk_operations;
+static void free_ramdisk (struct ramdisk *, size_t page_cnt);
+
+/* Creates and registers a RAM disk named NAME of the given TYPE
+   with SIZE sectors, all initially zero.  Returns the new block
+   device, or a null pointer if there is not enough memory, in
+   which case nothing is allocated. */
+struct block *
+ramdisk_create (const char *name, enum block_type type, block_sector_t size)
+{
+  size_t page_cnt = DIV_ROUND_UP (size, SECTORS_PER_PAGE);
+  size_t free_cnt = palloc_free_cnt (0);
+  struct ramdisk *rd;
+  size_t i;
+
+  if (page_cnt > free_cnt - free_cnt / RESERVE_DIV)
+    {
+      printf ("%s: %zu pages for RAM disk exceed free memory\n",
+              name, page_cnt);
+      return NULL;
+    }
+
+  rd = malloc (sizeof *rd);
+  if (rd == NULL)
+    return NULL;
+  rd->page_cnt = page_cnt;
+  rd->pages = malloc (page_cnt * sizeof *rd->pages);
+  if (rd->pages == NULL)
+    {
+      free (rd);
+      return NULL;
+    }
+  for (i = 0; i < page_cnt; i++)
+    {
+      rd->pages[i] = palloc_get_page (PAL_ZERO);
+      if (rd->pages[i] == NULL)
+        {
+          printf ("%s: out of memory after %zu of %zu pages\n",
+                  name, i, page_cnt);
+          free_ramdisk (rd, i);
+          return NULL;
+        }
+    }
+
+  return block_register (name, type, "RAM disk", size,
+                         &ramdisk_operations, rd);
+}
+
+/* Frees RD and the first PAGE_CNT of its pages. */
+static void
+free_ramdisk (struct ramdisk *rd, size_t page_cnt)
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    palloc_free_page (rd->pages[i]);
+  free (rd->pages);
+  free (rd);
+}
+
+/* Returns the address of SECTOR in RD. */
+static void *
+sector_addr (struct ramdisk *rd, block_sector_t sector)
+{
+  ASSERT (sector / SECTORS_PER_PAGE < rd->page_cnt);
+  return (rd->pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Reads sector SECTOR from RAM disk RD into BUFFER, which must
+   have room for BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_read (void *rd, block_sector_t sector, void *buffer)
+{
+  memcpy (buffer, sector_addr (rd, sector), BLOCK_SECTOR_SIZE);
+}
+
+/* Writes sector SECTOR to RAM disk RD from BUFFER, which must
+   contain BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_write (void *rd, block_sector_t sector, const void *buffer)
+{
+  memcpy (sector_addr (rd, sector), buffer, BLOCK_SECTOR_SIZE);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write,
+    NULL
+  };
@@ -1,7 +1,7 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <string.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -33,6 +33,14 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable receive and transmit FIFOs. */
+#define FCR_CLEAR_RECV 0x02     /* Clear receive FIFO. */
+#define FCR_CLEAR_XMIT 0x04     /* Clear transmit FIFO. */
+
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0           /* Both set if FIFOs are enabled. */
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -51,11 +59,29 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Data to be transmitted, as a circular buffer.  TXQ_SIZE must
+   be a power of 2.  txq_head and txq_tail only ever increase, so
+   their difference is the number of bytes queued.  Interrupts
+   must be off to access them. */
+#define TXQ_SIZE 4096
+static uint8_t txq[TXQ_SIZE];
+static unsigned txq_head;       /* New data is written here. */
+static unsigned txq_tail;       /* Old data is read here. */
+
+/* Threads waiting for room in txq.  They are woken up once the
+   queue has drained to half full, so that each one then has room
+   for a good-sized batch. */
+static struct semaphore txq_room;
+static unsigned txq_waiters;
+
+/* Number of bytes the transmitter accepts each time it signals
+   that it is empty: the transmit FIFO depth, or 1 if the UART
+   has no FIFO. */
+static unsigned xmit_fifo_size = 1;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void fill_xmit_fifo (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -71,7 +97,6 @@ init_poll (void)
   outb (FCR_REG, 0);                    /* Disable FIFO. */
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-  intq_init (&txq);
   mode = POLL;
 } 
 
@@ -87,6 +112,16 @@ serial_init_queue (void)
     init_poll ();
   ASSERT (mode == POLL);
 
+  /* Enable the FIFOs, if the UART has them.  A 16550A reports
+     its FIFOs as enabled in the IIR; an 8250 or 16450 has none,
+     and a buggy 16550 has one we cannot trust. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR_RECV | FCR_CLEAR_XMIT);
+  if ((inb (IIR_REG) & IIR_FIFO) == IIR_FIFO)
+    xmit_fifo_size = 16;
+  else
+    outb (FCR_REG, 0);
+
+  sema_init (&txq_room, 0);
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
   mode = QUEUE;
   old_level = intr_disable ();
@@ -94,35 +129,90 @@ serial_init_queue (void)
   intr_set_level (old_level);
 }
 
+/* Returns the number of bytes in txq. */
+static unsigned
+txq_cnt (void)
+{
+  return txq_head - txq_tail;
+}
+
+/* Removes and returns the oldest byte in txq, which must not be
+   empty. */
+static uint8_t
+txq_getc (void)
+{
+  ASSERT (txq_cnt () > 0);
+  return txq[txq_tail++ % TXQ_SIZE];
+}
+
 /* Sends BYTE to the serial port. */
 void
 serial_putc (uint8_t byte) 
 {
+  serial_putbuf (&byte, 1);
+}
+
+/* Sends the SIZE bytes in BUFFER to the serial port.  Interrupts
+   are turned off only once for the whole buffer, rather than
+   once per byte. */
+void
+serial_putbuf (const void *buffer, size_t size)
+{
+  const uint8_t *p = buffer;
   enum intr_level old_level = intr_disable ();
 
   if (mode != QUEUE)
     {
       /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
+         use dumb polling to transmit the bytes. */
       if (mode == UNINIT)
         init_poll ();
-      putc_poll (byte); 
+      while (size-- > 0)
+        putc_poll (*p++);
     }
   else 
     {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      /* Otherwise, queue as many bytes at a time as fit. */
+      while (size > 0)
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          unsigned ofs = txq_head % TXQ_SIZE;
+          size_t chunk = TXQ_SIZE - txq_cnt ();
+
+          if (chunk == 0)
+            {
+              if (old_level == INTR_OFF)
+                {
+                  /* Interrupts are off and the transmit queue is
+                     full.  If we wanted to wait for the queue to
+                     empty, we'd have to reenable interrupts.
+                     That's impolite, so we'll send a character
+                     via polling instead. */
+                  putc_poll (txq_getc ());
+                }
+              else
+                {
+                  /* Wait for the interrupt handler to drain the
+                     queue. */
+                  txq_waiters++;
+                  write_ier ();
+                  sema_down (&txq_room);
+                }
+              continue;
+            }
+
+          if (chunk > size)
+            chunk = size;
+          if (chunk > TXQ_SIZE - ofs)
+            chunk = TXQ_SIZE - ofs;
+          memcpy (txq + ofs, p, chunk);
+          txq_head += chunk;
+          p += chunk;
+          size -= chunk;
         }
 
-      intq_putc (&txq, byte); 
+      /* Start transmitting right away if the transmitter is
+         idle, then update the interrupt enable register. */
+      fill_xmit_fifo ();
       write_ier ();
     }
   
@@ -135,8 +225,8 @@ void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
-  while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+  while (txq_cnt () > 0)
+    putc_poll (txq_getc ());
   intr_set_level (old_level);
 }
 
@@ -182,7 +272,7 @@ write_ier (void)
 
   /* Enable transmit interrupt if we have any characters to
      transmit. */
-  if (!intq_empty (&txq))
+  if (txq_cnt () > 0)
     ier |= IER_XMIT;
 
   /* Enable receive interrupt if we have room to store any
@@ -205,6 +295,29 @@ putc_poll (uint8_t byte)
   outb (THR_REG, byte);
 }
 
+/* If the transmitter is empty, refills it with as many bytes
+   from txq as it can take, and wakes up any threads waiting for
+   room in txq once it is half empty. */
+static void
+fill_xmit_fifo (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (txq_cnt () > 0 && (inb (LSR_REG) & LSR_THRE) != 0)
+    {
+      /* An empty transmitter has room for a whole FIFO's worth,
+         so there is no need to check LSR between bytes. */
+      unsigned i;
+
+      for (i = 0; i < xmit_fifo_size && txq_cnt () > 0; i++)
+        outb (THR_REG, txq_getc ());
+    }
+
+  if (txq_waiters > 0 && txq_cnt () <= TXQ_SIZE / 2)
+    for (; txq_waiters > 0; txq_waiters--)
+      sema_up (&txq_room);
+}
+
 /* Serial interrupt handler. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) 
@@ -218,10 +331,9 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* If we have bytes to transmit, and the hardware is ready to
+     accept them, transmit a FIFO's worth. */
+  fill_xmit_fifo ();
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
@@ -1,19 +1,28 @@
 #include "devices/shutdown.h"
 #include <console.h>
+#include <klog.h>
 #include <stdio.h>
 #include "devices/kbd.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
+#include "filesys/cache.h"
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #endif
 #include "vm/frame.h"
+#ifdef VM
+#include "vm/swap.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -45,6 +54,41 @@ shutdown (void)
     }
 }
 
+/* Finishes deferred work before an orderly shutdown, by running
+   every queued work item, writing out the kernel log, and
+   writing the file system's cached data to disk.  (On panic,
+   console_panic() writes out the log instead, and cached file
+   data is lost.)  Must be called from a kernel thread with
+   interrupts on; in particular, the panic path must not call it,
+   since the work it waits for might never finish and the locks
+   it takes might never be released. */
+void
+shutdown_flush (void)
+{
+  ASSERT (!intr_context ());
+  ASSERT (intr_get_level () == INTR_ON);
+
+  workqueue_flush ();
+  klog_flush ();
+#ifdef FILESYS
+  filesys_done ();
+#endif
+}
+
+/* Finishes deferred work with shutdown_flush(), then shuts down
+   the machine in the way configured by shutdown_configure().  If
+   the shutdown type is SHUTDOWN_NONE, returns without doing
+   anything, leaving the kernel running. */
+void
+shutdown_orderly (void)
+{
+  if (how != SHUTDOWN_NONE)
+    {
+      shutdown_flush ();
+      shutdown ();
+    }
+}
+
 /* Sets TYPE as the way that machine will shut down when Pintos
    execution is complete. */
 void
@@ -91,9 +135,6 @@ shutdown_power_off (void)
   const char s[] = "Shutdown";
   const char *p;
 
-#ifdef FILESYS
-  filesys_done ();
-#endif
   frametable_free ();
 
   print_stats ();
@@ -124,8 +165,16 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  adaptive_lock_print_stats ();
+  workqueue_print_stats ();
+  klog_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
+  cache_print_stats ();
+  dcache_print_stats ();
+#endif
+#ifdef VM
+  swap_print_stats ();
 #endif
   console_print_stats ();
   kbd_print_stats ();
@@ -109,6 +109,17 @@ sleeping_thread_less(const struct list_elem *a,
   return x->end_time < y->end_time;
 }
 
+/* Returns the CPU's time-stamp counter.  This counts CPU cycles
+   since reset, far more finely than timer ticks, and is cheap
+   enough to read on every context switch. */
+uint64_t
+timer_cycles (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
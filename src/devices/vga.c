@@ -10,6 +10,9 @@
 
 /* VGA text screen support.  See [FREEVGA] for more information. */
 
+/* Most characters vga_putbuf() draws with interrupts off. */
+#define BATCH_SIZE 512
+
 /* Number of columns and rows on the text display. */
 #define COL_CNT 80
 #define ROW_CNT 25
@@ -31,6 +34,7 @@ static void cls (void);
 static void newline (void);
 static void move_cursor (void);
 static void find_cursor (size_t *x, size_t *y);
+static void put (int c);
 
 /* Initializes the VGA text display. */
 static void
@@ -50,13 +54,53 @@ init (void)
    characters in the conventional ways.  */
 void
 vga_putc (int c)
+{
+  char ch = c;
+  vga_putbuf (&ch, 1);
+}
+
+/* Writes the SIZE characters in BUFFER to the VGA text display,
+   like vga_putc(), but moving the hardware cursor only once.
+   Interrupts are briefly reenabled every BATCH_SIZE characters,
+   so that a large buffer does not hold them off for long. */
+void
+vga_putbuf (const char *buffer, size_t size)
 {
   /* Disable interrupts to lock out interrupt handlers
      that might write to the console. */
   enum intr_level old_level = intr_disable ();
+  size_t i;
 
   init ();
-  
+
+  for (i = 0; i < size; i++)
+    {
+      int c = (uint8_t) buffer[i];
+      if (i % BATCH_SIZE == BATCH_SIZE - 1)
+        {
+          intr_set_level (old_level);
+          intr_disable ();
+        }
+      if (c == '\a')
+        {
+          intr_set_level (old_level);
+          speaker_beep ();
+          intr_disable ();
+        }
+      else
+        put (c);
+    }
+
+  /* Update cursor position. */
+  move_cursor ();
+
+  intr_set_level (old_level);
+}
+
+/* Writes C, which must not be a bell, to the framebuffer. */
+static void
+put (int c)
+{
   switch (c) 
     {
     case '\n':
@@ -82,12 +126,6 @@ vga_putc (int c)
         newline ();
       break;
 
-    case '\a':
-      intr_set_level (old_level);
-      speaker_beep ();
-      intr_disable ();
-      break;
-      
     default:
       fb[cy][cx][0] = c;
       fb[cy][cx][1] = GRAY_ON_BLACK;
@@ -95,11 +133,6 @@ vga_putc (int c)
         newline ();
       break;
     }
-
-  /* Update cursor position. */
-  move_cursor ();
-
-  intr_set_level (old_level);
 }
 
 /* Clears the screen and moves the cursor to the upper left. */
@@ -0,0 +1,44 @@
+/* iostat.c
+
+   Prints I/O statistics for each block device. */
+
+#include <iostat.h>
+#include <stdio.h>
+#include <syscall.h>
+
+int
+main (void)
+{
+  struct iostat stats;
+  int i;
+
+  for (i = 0; iostat (i, &stats); i++)
+    {
+      int d;
+
+      printf ("%s (%s): max depth %u, %llu commands\n",
+              stats.name, stats.type, stats.max_depth, stats.command_cnt);
+      for (d = 0; d < 2; d++)
+        {
+          const struct iostat_dir *dir = &stats.dir[d];
+          int b;
+
+          if (dir->request_cnt == 0)
+            continue;
+          printf ("  %s: %llu sectors in %llu requests, "
+                  "%llu cycles queued, %llu cycles in service\n",
+                  d == 0 ? "read" : "write", dir->sector_cnt,
+                  dir->request_cnt, dir->queue_cycles, dir->service_cycles);
+          printf ("  latency (log2 cycles: requests):");
+          for (b = 0; b < IOSTAT_BUCKETS; b++)
+            if (dir->latency[b] != 0)
+              printf (" %d: %u", b, dir->latency[b]);
+          printf ("\n");
+        }
+      if (stats.lock_cnt != 0)
+        printf ("  channel lock: %llu acquisitions, %llu contended, "
+                "%llu cycles waiting\n", stats.lock_cnt,
+                stats.lock_contended_cnt, stats.lock_wait_cycles);
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,375 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+/* Write-back cache of file system sectors.
+
+   Every access to fs_device by the file system goes through
+   here.  Entries are replaced by the clock algorithm and written
+   back when evicted, by a periodic flusher thread, and by
+   cache_flush() at shutdown. */
+
+/* Number of cached sectors. */
+#define CACHE_SIZE 64
+
+/* How often the flusher writes back dirty sectors, in timer
+   ticks. */
+#define FLUSH_INTERVAL (5 * TIMER_FREQ)
+
+/* A cached sector. */
+struct cache_entry
+  {
+    /* Protected by cache_lock. */
+    block_sector_t sector;      /* Sector held, if in_use. */
+    bool in_use;                /* True if SECTOR is cached here. */
+    bool accessed;              /* Clock reference bit. */
+
+    /* Changed only with interrupts off.  An entry with a nonzero
+       pin count is never evicted. */
+    int pin_cnt;
+
+    /* Protect the sector data and the flags below. */
+    struct rw_lock lock;
+    bool loaded;                /* True once DATA has been read in. */
+    bool dirty;                 /* True if DATA differs from disk. */
+    uint8_t data[BLOCK_SECTOR_SIZE];
+  };
+
+static struct cache_entry cache[CACHE_SIZE];
+
+/* Protects the sector-to-entry mapping and the clock hand. */
+static struct lock cache_lock;
+static size_t clock_hand;
+
+/* Sectors waiting to be read ahead, as a ring buffer.  Protected
+   by disabling interrupts.  Requests that do not fit are
+   dropped; read-ahead is only a hint. */
+#define READAHEAD_QUEUE 32
+static block_sector_t readahead_queue[READAHEAD_QUEUE];
+static size_t readahead_head, readahead_cnt;
+
+/* Reads the queued sectors in on a worker thread. */
+static struct work readahead_work;
+
+/* Statistics. */
+static long long hit_cnt;       /* # of accesses found in cache. */
+static long long miss_cnt;      /* # of accesses that missed. */
+static long long writeback_cnt; /* # of dirty sectors written. */
+static long long prefetch_cnt;  /* # of sectors read ahead. */
+
+static thread_func flusher;
+static work_func readahead;
+static struct cache_entry *cache_get (block_sector_t, bool write,
+                                      bool overwrite);
+static void cache_put (struct cache_entry *, bool write);
+static struct cache_entry *lookup (block_sector_t);
+static struct cache_entry *evict (void);
+
+/* Initializes the buffer cache and starts its flusher thread. */
+void
+cache_init (void)
+{
+  size_t i;
+
+  lock_init (&cache_lock);
+  for (i = 0; i < CACHE_SIZE; i++)
+    rw_lock_init (&cache[i].lock);
+  work_init (&readahead_work, readahead, NULL);
+
+  if (thread_create ("cache-flush", PRI_DEFAULT, flusher, NULL)
+      == TID_ERROR)
+    PANIC ("cache_init: can't create flusher thread");
+}
+
+/* Reads SIZE bytes at offset OFS within SECTOR into BUFFER. */
+void
+cache_read (block_sector_t sector, void *buffer, size_t ofs, size_t size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs + size <= BLOCK_SECTOR_SIZE);
+
+  e = cache_get (sector, false, false);
+  memcpy (buffer, e->data + ofs, size);
+  cache_put (e, false);
+}
+
+/* Writes SIZE bytes from BUFFER at offset OFS within SECTOR.
+   A write of the whole sector does not read the old contents
+   from disk. */
+void
+cache_write (block_sector_t sector, const void *buffer,
+             size_t ofs, size_t size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs + size <= BLOCK_SECTOR_SIZE);
+
+  e = cache_get (sector, true, size == BLOCK_SECTOR_SIZE);
+  memcpy (e->data + ofs, buffer, size);
+  e->dirty = true;
+  cache_put (e, true);
+}
+
+/* Asks for SECTOR to be brought into the cache in the
+   background, in anticipation of a read.  Returns without
+   waiting. */
+void
+cache_readahead (block_sector_t sector)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (readahead_cnt < READAHEAD_QUEUE)
+    {
+      readahead_queue[(readahead_head + readahead_cnt++)
+                      % READAHEAD_QUEUE] = sector;
+      work_submit (&readahead_work, WORK_PRI_HIGH);
+    }
+  intr_set_level (old_level);
+}
+
+/* Writes every dirty sector back to disk. */
+void
+cache_flush (void)
+{
+  size_t i;
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    {
+      struct cache_entry *e = &cache[i];
+      enum intr_level old_level;
+
+      /* Pin the entry so it cannot be evicted while we wait for
+         its lock. */
+      lock_acquire (&cache_lock);
+      if (!e->in_use)
+        {
+          lock_release (&cache_lock);
+          continue;
+        }
+      old_level = intr_disable ();
+      e->pin_cnt++;
+      intr_set_level (old_level);
+      lock_release (&cache_lock);
+
+      /* Holding the lock for reading excludes writers, so the
+         entry cannot be redirtied underneath us. */
+      rw_lock_acquire_read (&e->lock);
+      if (e->loaded && e->dirty)
+        {
+          block_write (fs_device, e->sector, e->data);
+          e->dirty = false;
+          writeback_cnt++;
+        }
+      cache_put (e, false);
+    }
+}
+
+/* Prints buffer cache statistics. */
+void
+cache_print_stats (void)
+{
+  printf ("Cache: %lld hits, %lld misses, %lld write-backs, "
+          "%lld read ahead\n",
+          hit_cnt, miss_cnt, writeback_cnt, prefetch_cnt);
+}
+
+/* Returns the cache entry for SECTOR, pinned and locked for
+   writing if WRITE, otherwise for reading.  Loads the sector
+   from disk unless OVERWRITE, in which case the caller will
+   replace all of its contents. */
+static struct cache_entry *
+cache_get (block_sector_t sector, bool write, bool overwrite)
+{
+  struct cache_entry *e;
+  enum intr_level old_level;
+
+  lock_acquire (&cache_lock);
+  for (;;)
+    {
+      while ((e = lookup (sector)) == NULL && (e = evict ()) == NULL)
+        continue;
+      if (!e->in_use || e->sector == sector || !e->loaded || !e->dirty)
+        break;
+
+      /* The victim is dirty.  Write it back without holding
+         cache_lock, so that hits on other entries need not wait
+         for the disk.  The entry keeps its old sector meanwhile,
+         pinned and locked, so that anyone who wants that sector
+         waits for it rather than reading stale data from disk.
+         It was unpinned, so its lock is free.  Then look again,
+         since SECTOR may have been brought in meanwhile. */
+      old_level = intr_disable ();
+      e->pin_cnt++;
+      intr_set_level (old_level);
+      rw_lock_acquire_write (&e->lock);
+      lock_release (&cache_lock);
+
+      block_write (fs_device, e->sector, e->data);
+      e->dirty = false;
+      writeback_cnt++;
+      cache_put (e, true);
+
+      lock_acquire (&cache_lock);
+    }
+  if (e->in_use && e->sector == sector)
+    {
+      hit_cnt++;
+      e->accessed = true;
+      old_level = intr_disable ();
+      e->pin_cnt++;
+      intr_set_level (old_level);
+      lock_release (&cache_lock);
+    }
+  else
+    {
+      miss_cnt++;
+      e->sector = sector;
+      e->in_use = true;
+      e->accessed = true;
+      e->loaded = false;
+      e->dirty = false;
+      e->pin_cnt = 1;
+
+      /* Anyone else looking for SECTOR will find this entry and
+         wait on its lock until the data is in. */
+      rw_lock_acquire_write (&e->lock);
+      lock_release (&cache_lock);
+      if (!overwrite)
+        {
+          block_read (fs_device, sector, e->data);
+          e->loaded = true;
+        }
+      if (write)
+        return e;
+      rw_lock_release_write (&e->lock);
+    }
+
+  /* Whoever brought the sector in held the lock for writing
+     until it was loaded, so once we have the lock it is. */
+  if (write)
+    rw_lock_acquire_write (&e->lock);
+  else
+    rw_lock_acquire_read (&e->lock);
+  ASSERT (e->loaded);
+  return e;
+}
+
+/* Unlocks and unpins E, which was locked for writing if WRITE. */
+static void
+cache_put (struct cache_entry *e, bool write)
+{
+  enum intr_level old_level;
+
+  if (write)
+    {
+      e->loaded = true;
+      rw_lock_release_write (&e->lock);
+    }
+  else
+    rw_lock_release_read (&e->lock);
+
+  old_level = intr_disable ();
+  e->pin_cnt--;
+  intr_set_level (old_level);
+}
+
+/* Returns the entry holding SECTOR, or a null pointer.
+   cache_lock must be held. */
+static struct cache_entry *
+lookup (block_sector_t sector)
+{
+  size_t i;
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (cache[i].in_use && cache[i].sector == sector)
+      return &cache[i];
+  return NULL;
+}
+
+/* Chooses an unpinned entry to reuse, by the clock algorithm.
+   cache_lock must be held.  If every entry is pinned, releases
+   cache_lock for a while and returns a null pointer, so that the
+   caller must look the sector up again. */
+static struct cache_entry *
+evict (void)
+{
+  size_t i;
+
+  for (i = 0; i < 2 * CACHE_SIZE; i++)
+    {
+      struct cache_entry *e = &cache[clock_hand];
+      clock_hand = (clock_hand + 1) % CACHE_SIZE;
+
+      if (!e->in_use)
+        return e;
+      if (e->pin_cnt > 0)
+        continue;
+      if (e->accessed)
+        e->accessed = false;
+      else
+        return e;
+    }
+
+  /* Every entry is pinned.  Let their users finish. */
+  lock_release (&cache_lock);
+  thread_yield ();
+  lock_acquire (&cache_lock);
+  return NULL;
+}
+
+/* Work function that reads in each sector queued by
+   cache_readahead() that is not already cached. */
+static void
+readahead (void *aux UNUSED)
+{
+  for (;;)
+    {
+      enum intr_level old_level;
+      block_sector_t sector;
+      bool cached;
+
+      old_level = intr_disable ();
+      if (readahead_cnt == 0)
+        {
+          intr_set_level (old_level);
+          break;
+        }
+      sector = readahead_queue[readahead_head];
+      readahead_head = (readahead_head + 1) % READAHEAD_QUEUE;
+      readahead_cnt--;
+      intr_set_level (old_level);
+
+      lock_acquire (&cache_lock);
+      cached = lookup (sector) != NULL;
+      lock_release (&cache_lock);
+      if (!cached)
+        {
+          cache_put (cache_get (sector, false, false), false);
+          prefetch_cnt++;
+        }
+    }
+}
+
+/* Flusher thread.  Periodically writes back dirty sectors so
+   that a crash loses little data.  The free map batches its own
+   changes, so bring them into the cache first. */
+static void
+flusher (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_sleep (FLUSH_INTERVAL);
+      free_map_sync ();
+      cache_flush ();
+    }
+}
@@ -0,0 +1,197 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/synch.h"
+
+/* Directory entry cache.
+
+   Maps a (directory inode sector, name) pair to the sector of
+   the inode the name refers to, so that resolving a path whose
+   components were looked up recently reads no directory data.
+   The directory code keeps the cache coherent: it inserts names
+   it finds and invalidates names it removes, all while holding
+   the directory's lock.  Entries are replaced in least recently
+   used order. */
+
+/* Number of cached names. */
+#define DCACHE_SIZE 128
+
+/* A cached name. */
+struct dentry
+  {
+    struct hash_elem hash_elem;         /* Element in dentries, if in use. */
+    struct list_elem lru_elem;          /* Element in lru. */
+    bool in_use;                        /* True if in dentries. */
+    block_sector_t dir;                 /* Containing directory's sector. */
+    char name[NAME_MAX + 1];            /* Null terminated name. */
+    block_sector_t sector;              /* Sector NAME refers to. */
+  };
+
+static struct dentry dentry_pool[DCACHE_SIZE];
+
+/* Entries in use, by directory and name, and every entry, most
+   recently used first.  Protected by dcache_lock. */
+static struct hash dentries;
+static struct list lru;
+static struct lock dcache_lock;
+
+/* Statistics. */
+static long long hit_cnt;       /* # of lookups found in cache. */
+static long long miss_cnt;      /* # of lookups that missed. */
+
+static hash_hash_func dentry_hash;
+static hash_less_func dentry_less;
+static struct dentry *find_dentry (block_sector_t dir, const char *name);
+static void discard (struct dentry *);
+
+/* Initializes the directory entry cache. */
+void
+dcache_init (void)
+{
+  size_t i;
+
+  if (!hash_init (&dentries, dentry_hash, dentry_less, NULL))
+    PANIC ("dcache_init: out of memory");
+  list_init (&lru);
+  lock_init (&dcache_lock);
+  for (i = 0; i < DCACHE_SIZE; i++)
+    list_push_back (&lru, &dentry_pool[i].lru_elem);
+}
+
+/* Looks up NAME in the directory whose inode is in sector DIR.
+   If it is cached, stores the sector it refers to in *SECTORP
+   and returns true.  Otherwise returns false. */
+bool
+dcache_lookup (block_sector_t dir, const char *name, block_sector_t *sectorp)
+{
+  struct dentry *d;
+
+  lock_acquire (&dcache_lock);
+  d = find_dentry (dir, name);
+  if (d != NULL)
+    {
+      hit_cnt++;
+      *sectorp = d->sector;
+      list_remove (&d->lru_elem);
+      list_push_front (&lru, &d->lru_elem);
+    }
+  else
+    miss_cnt++;
+  lock_release (&dcache_lock);
+
+  return d != NULL;
+}
+
+/* Records that NAME in the directory whose inode is in sector
+   DIR refers to SECTOR. */
+void
+dcache_insert (block_sector_t dir, const char *name, block_sector_t sector)
+{
+  struct dentry *d;
+
+  ASSERT (strlen (name) <= NAME_MAX);
+
+  lock_acquire (&dcache_lock);
+  d = find_dentry (dir, name);
+  if (d == NULL)
+    {
+      /* Reuse the least recently used entry. */
+      d = list_entry (list_back (&lru), struct dentry, lru_elem);
+      if (d->in_use)
+        hash_delete (&dentries, &d->hash_elem);
+      d->dir = dir;
+      strlcpy (d->name, name, sizeof d->name);
+      d->in_use = true;
+      hash_insert (&dentries, &d->hash_elem);
+    }
+  d->sector = sector;
+  list_remove (&d->lru_elem);
+  list_push_front (&lru, &d->lru_elem);
+  lock_release (&dcache_lock);
+}
+
+/* Forgets NAME in the directory whose inode is in sector DIR. */
+void
+dcache_invalidate (block_sector_t dir, const char *name)
+{
+  struct dentry *d;
+
+  lock_acquire (&dcache_lock);
+  d = find_dentry (dir, name);
+  if (d != NULL)
+    discard (d);
+  lock_release (&dcache_lock);
+}
+
+/* Forgets every name in the directory whose inode is in sector
+   DIR, which is being removed. */
+void
+dcache_invalidate_dir (block_sector_t dir)
+{
+  size_t i;
+
+  lock_acquire (&dcache_lock);
+  for (i = 0; i < DCACHE_SIZE; i++)
+    if (dentry_pool[i].in_use && dentry_pool[i].dir == dir)
+      discard (&dentry_pool[i]);
+  lock_release (&dcache_lock);
+}
+
+/* Prints directory entry cache statistics. */
+void
+dcache_print_stats (void)
+{
+  printf ("Dentry cache: %lld hits, %lld misses\n", hit_cnt, miss_cnt);
+}
+
+/* Returns a hash value for dentry E. */
+static unsigned
+dentry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct dentry *d = hash_entry (e, struct dentry, hash_elem);
+  return hash_string (d->name) ^ hash_int (d->dir);
+}
+
+/* Returns true if dentry A precedes dentry B. */
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct dentry *a = hash_entry (a_, struct dentry, hash_elem);
+  const struct dentry *b = hash_entry (b_, struct dentry, hash_elem);
+
+  if (a->dir != b->dir)
+    return a->dir < b->dir;
+  return strcmp (a->name, b->name) < 0;
+}
+
+/* Returns the entry for NAME in DIR, or a null pointer.
+   dcache_lock must be held. */
+static struct dentry *
+find_dentry (block_sector_t dir, const char *name)
+{
+  struct dentry key;
+  struct hash_elem *e;
+
+  if (strlen (name) > NAME_MAX)
+    return NULL;
+  key.dir = dir;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dentries, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct dentry, hash_elem) : NULL;
+}
+
+/* Removes D from the cache and makes it the first to be reused.
+   dcache_lock must be held. */
+static void
+discard (struct dentry *d)
+{
+  hash_delete (&dentries, &d->hash_elem);
+  d->in_use = false;
+  list_remove (&d->lru_elem);
+  list_push_back (&lru, &d->lru_elem);
+}
@@ -1,7 +1,9 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
@@ -10,10 +12,23 @@
 struct dir 
   {
     struct inode *inode;                /* Backing store. */
-    off_t pos;                          /* Current position. */
+    char (*names)[NAME_MAX + 1];        /* Names for dir_readdir(). */
+    size_t name_cnt;                    /* Number of NAMES. */
+    size_t pos;                         /* Next of NAMES to return. */
   };
 
-/* A single directory entry. */
+/* A single directory entry.
+
+   A directory is an open-addressed hash table of entries: the
+   entry for a name lives in the slot given by hashing the name,
+   or in one of the slots following it.  A slot whose name is
+   empty has never been used and ends every probe sequence
+   through it.  Removing an entry only clears IN_USE, leaving its
+   name behind so that later probes continue past it.
+
+   Every directory has entries "." for itself and ".." for its
+   parent, which dir_readdir() skips and dir_remove() refuses to
+   remove. */
 struct dir_entry 
   {
     block_sector_t inode_sector;        /* Sector number of header. */
@@ -21,12 +36,48 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* dir_add() doubles a directory's size rather than place an
+   entry more than this many slots past the slot its name hashes
+   to, keeping probe sequences short. */
+#define PROBE_MAX 8
+
+/* Minimum number of slots in a directory. */
+#define MIN_SLOTS 16
+
+/* dir_remove() rehashes a directory once the names left behind
+   by removed entries fill more than 1/TOMBSTONE_DIV of its
+   slots, since lookups must probe past every one of them. */
+#define TOMBSTONE_DIV 4
+
+static size_t slot_cnt (const struct dir *);
+static off_t find_free_slot (const struct dir *, const char *name);
+static bool rehash (struct dir *, size_t new_cnt);
+static bool grow (struct dir *);
+static size_t tombstone_cnt (const struct dir *);
+static bool read_names (struct dir *);
+static bool is_dot (const char *name);
+static bool is_empty (struct inode *);
+
 /* Creates a directory with space for ENTRY_CNT entries in the
-   given SECTOR.  Returns true if successful, false on failure. */
+   given SECTOR, whose parent directory is in sector PARENT.
+   Returns true if successful, false on failure. */
 bool
-dir_create (block_sector_t sector, size_t entry_cnt)
+dir_create (block_sector_t sector, block_sector_t parent, size_t entry_cnt)
 {
-  return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+  struct dir *dir;
+  bool success;
+
+  if (entry_cnt < MIN_SLOTS)
+    entry_cnt = MIN_SLOTS;
+  if (!inode_create (sector, entry_cnt * sizeof (struct dir_entry), true))
+    return false;
+
+  dir = dir_open (inode_open (sector));
+  success = (dir != NULL
+             && dir_add (dir, ".", sector)
+             && dir_add (dir, "..", parent));
+  dir_close (dir);
+  return success;
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -38,6 +89,8 @@ dir_open (struct inode *inode)
   if (inode != NULL && dir != NULL)
     {
       dir->inode = inode;
+      dir->names = NULL;
+      dir->name_cnt = 0;
       dir->pos = 0;
       return dir;
     }
@@ -72,6 +125,7 @@ dir_close (struct dir *dir)
   if (dir != NULL)
     {
       inode_close (dir->inode);
+      free (dir->names);
       free (dir);
     }
 }
@@ -93,22 +147,164 @@ lookup (const struct dir *dir, const char *name,
         struct dir_entry *ep, off_t *ofsp) 
 {
   struct dir_entry e;
-  size_t ofs;
+  size_t cnt, slot, i;
   
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (e.in_use && !strcmp (name, e.name)) 
+  cnt = slot_cnt (dir);
+  if (cnt == 0)
+    return false;
+
+  slot = hash_string (name) % cnt;
+  for (i = 0; i < cnt; i++, slot = (slot + 1) % cnt)
+    {
+      off_t ofs = slot * sizeof e;
+      if (inode_read_at (dir->inode, &e, sizeof e, ofs) != sizeof e
+          || e.name[0] == '\0')
+        break;
+      if (e.in_use && !strcmp (name, e.name)) 
+        {
+          if (ep != NULL)
+            *ep = e;
+          if (ofsp != NULL)
+            *ofsp = ofs;
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Returns the number of entry slots in DIR. */
+static size_t
+slot_cnt (const struct dir *dir)
+{
+  return inode_length (dir->inode) / sizeof (struct dir_entry);
+}
+
+/* Returns the byte offset of a free slot in DIR within PROBE_MAX
+   slots of where NAME hashes to, or -1 if there is none. */
+static off_t
+find_free_slot (const struct dir *dir, const char *name)
+{
+  struct dir_entry e;
+  size_t cnt, slot, i;
+
+  cnt = slot_cnt (dir);
+  if (cnt == 0)
+    return -1;
+
+  slot = hash_string (name) % cnt;
+  for (i = 0; i < PROBE_MAX && i < cnt; i++, slot = (slot + 1) % cnt)
+    {
+      off_t ofs = slot * sizeof e;
+      if (inode_read_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+        break;
+      if (!e.in_use)
+        return ofs;
+    }
+  return -1;
+}
+
+/* Doubles the number of slots in DIR and rehashes its entries
+   into them.  Returns true if successful, false if memory or
+   disk space ran out, in which case DIR is unchanged. */
+static bool
+grow (struct dir *dir)
+{
+  size_t old_cnt = slot_cnt (dir);
+
+  return rehash (dir, old_cnt < MIN_SLOTS ? MIN_SLOTS : old_cnt * 2);
+}
+
+/* Rehashes the entries of DIR into NEW_CNT slots, which must be
+   at least as many as it has, dropping the names left behind by
+   removed entries.  Returns true if successful, false if memory
+   or disk space ran out, in which case DIR is unchanged. */
+static bool
+rehash (struct dir *dir, size_t new_cnt)
+{
+  static const struct dir_entry empty;
+  struct dir_entry *entries;
+  size_t old_cnt, i;
+  off_t old_size;
+  bool success = false;
+
+  old_cnt = slot_cnt (dir);
+  ASSERT (new_cnt >= old_cnt);
+  old_size = old_cnt * sizeof *entries;
+
+  entries = malloc (old_size > 0 ? old_size : 1);
+  if (entries == NULL)
+    return false;
+  if (inode_read_at (dir->inode, entries, old_size, 0) != old_size)
+    goto done;
+
+  /* Extend the directory by writing its new last slot.  The
+     slots in between read back as zeros, that is, empty. */
+  if (new_cnt > old_cnt
+      && inode_write_at (dir->inode, &empty, sizeof empty,
+                         (new_cnt - 1) * sizeof empty) != sizeof empty)
+    goto done;
+
+  /* From here on nothing can fail: the space is allocated. */
+  for (i = 0; i < old_cnt; i++)
+    inode_write_at (dir->inode, &empty, sizeof empty, i * sizeof empty);
+  for (i = 0; i < old_cnt; i++)
+    if (entries[i].in_use)
       {
-        if (ep != NULL)
-          *ep = e;
-        if (ofsp != NULL)
-          *ofsp = ofs;
-        return true;
+        struct dir_entry e;
+        size_t slot = hash_string (entries[i].name) % new_cnt;
+
+        while (inode_read_at (dir->inode, &e, sizeof e, slot * sizeof e)
+               == sizeof e && e.name[0] != '\0')
+          slot = (slot + 1) % new_cnt;
+        inode_write_at (dir->inode, &entries[i], sizeof *entries,
+                        slot * sizeof *entries);
       }
-  return false;
+  success = true;
+
+ done:
+  free (entries);
+  return success;
+}
+
+/* Returns the number of slots in DIR that hold the name of a
+   removed entry. */
+static size_t
+tombstone_cnt (const struct dir *dir)
+{
+  struct dir_entry e;
+  size_t cnt = 0;
+  off_t ofs;
+
+  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+       ofs += sizeof e)
+    if (!e.in_use && e.name[0] != '\0')
+      cnt++;
+  return cnt;
+}
+
+/* Returns true if NAME is "." or "..". */
+static bool
+is_dot (const char *name)
+{
+  return !strcmp (name, ".") || !strcmp (name, "..");
+}
+
+/* Returns true if directory INODE has no entries but "." and
+   "..".  INODE's lock must be held. */
+static bool
+is_empty (struct inode *inode)
+{
+  struct dir_entry e;
+  off_t ofs;
+
+  for (ofs = 0; inode_read_at (inode, &e, sizeof e, ofs) == sizeof e;
+       ofs += sizeof e)
+    if (e.in_use && !is_dot (e.name))
+      return false;
+  return true;
 }
 
 /* Searches DIR for a file with the given NAME
@@ -119,15 +315,28 @@ bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode) 
 {
+  block_sector_t dir_sector, sector;
   struct dir_entry e;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
-  else
-    *inode = NULL;
+  dir_sector = inode_get_inumber (dir->inode);
+  *inode = NULL;
+
+  inode_lock (dir->inode);
+  if (inode_is_removed (dir->inode))
+    {
+      /* Nothing can be found in a removed directory. */
+    }
+  else if (dcache_lookup (dir_sector, name, &sector))
+    *inode = inode_open (sector);
+  else if (lookup (dir, name, &e, NULL))
+    {
+      dcache_insert (dir_sector, name, e.inode_sector);
+      *inode = inode_open (e.inode_sector);
+    }
+  inode_unlock (dir->inode);
 
   return *inode != NULL;
 }
@@ -136,8 +345,8 @@ dir_lookup (const struct dir *dir, const char *name,
    file by that name.  The file's inode is in sector
    INODE_SECTOR.
    Returns true if successful, false on failure.
-   Fails if NAME is invalid (i.e. too long) or a disk or memory
-   error occurs. */
+   Fails if NAME is invalid (i.e. too long), if DIR has been
+   removed, or if a disk or memory error occurs. */
 bool
 dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
 {
@@ -152,21 +361,17 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   if (*name == '\0' || strlen (name) > NAME_MAX)
     return false;
 
-  /* Check that NAME is not in use. */
-  if (lookup (dir, name, NULL, NULL))
+  inode_lock (dir->inode);
+
+  /* Check that DIR is still there and NAME is not in use. */
+  if (inode_is_removed (dir->inode) || lookup (dir, name, NULL, NULL))
     goto done;
 
-  /* Set OFS to offset of free slot.
-     If there are no free slots, then it will be set to the
-     current end-of-file.
-     
-     inode_read_at() will only return a short read at end of file.
-     Otherwise, we'd need to verify that we didn't get a short
-     read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (!e.in_use)
-      break;
+  /* Set OFS to offset of a free slot near where NAME hashes,
+     growing the directory if there is none. */
+  while ((ofs = find_free_slot (dir, name)) < 0)
+    if (!grow (dir))
+      goto done;
 
   /* Write slot. */
   e.in_use = true;
@@ -175,23 +380,31 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
  done:
+  inode_unlock (dir->inode);
   return success;
 }
 
 /* Removes any entry for NAME in DIR.
-   Returns true if successful, false on failure,
-   which occurs only if there is no file with the given NAME. */
+   Returns true if successful, false on failure, which occurs if
+   there is no file with the given NAME, if NAME is "." or "..",
+   or if NAME is a directory that is not empty. */
 bool
 dir_remove (struct dir *dir, const char *name) 
 {
   struct dir_entry e;
   struct inode *inode = NULL;
+  bool locked = false;
   bool success = false;
   off_t ofs;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  if (is_dot (name))
+    return false;
+
+  inode_lock (dir->inode);
+
   /* Find directory entry. */
   if (!lookup (dir, name, &e, &ofs))
     goto done;
@@ -201,36 +414,89 @@ dir_remove (struct dir *dir, const char *name)
   if (inode == NULL)
     goto done;
 
+  /* A directory must be empty.  Holding its lock keeps anything
+     from being added to it before it is marked removed.  Locks
+     are always taken parent first. */
+  if (inode_is_dir (inode))
+    {
+      inode_lock (inode);
+      locked = true;
+      if (!is_empty (inode))
+        goto done;
+    }
+
   /* Erase directory entry. */
   e.in_use = false;
   if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e) 
     goto done;
+  dcache_invalidate (inode_get_inumber (dir->inode), name);
+  if (inode_is_dir (inode))
+    dcache_invalidate_dir (e.inode_sector);
 
   /* Remove inode. */
   inode_remove (inode);
   success = true;
 
+  /* Drop the names of removed entries once there are many.  If
+     that fails, they just stay until the next try. */
+  if (tombstone_cnt (dir) > slot_cnt (dir) / TOMBSTONE_DIV)
+    rehash (dir, slot_cnt (dir));
+
  done:
+  if (locked)
+    inode_unlock (inode);
+  inode_unlock (dir->inode);
   inode_close (inode);
   return success;
 }
 
-/* Reads the next directory entry in DIR and stores the name in
-   NAME.  Returns true if successful, false if the directory
-   contains no more entries. */
-bool
-dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
+/* Reads the names of the entries in DIR, other than "." and
+   "..", into DIR->names.  Returns true if successful, false if
+   memory ran out.  DIR's inode lock must be held. */
+static bool
+read_names (struct dir *dir)
 {
   struct dir_entry e;
+  size_t cnt = slot_cnt (dir);
+  off_t ofs;
 
-  while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
+  dir->names = malloc (cnt > 0 ? cnt * sizeof *dir->names : 1);
+  if (dir->names == NULL)
+    return false;
+  dir->name_cnt = 0;
+  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+       ofs += sizeof e)
+    if (e.in_use && !is_dot (e.name))
+      strlcpy (dir->names[dir->name_cnt++], e.name, sizeof *dir->names);
+  return true;
+}
+
+/* Reads the next directory entry in DIR, other than "." and
+   "..", and stores the name in NAME.  Returns true if
+   successful, false if the directory contains no more entries.
+
+   The first call reads the names of all of DIR's entries at
+   once, and later calls return them in turn.  Adding or removing
+   an entry may rehash the directory and move every other entry
+   to a different slot, so walking the slots one call at a time
+   could skip or repeat entries.  Entries added or removed after
+   the first call may or may not be returned, as POSIX allows. */
+bool
+dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
+{
+  if (dir->names == NULL)
     {
-      dir->pos += sizeof e;
-      if (e.in_use)
-        {
-          strlcpy (name, e.name, NAME_MAX + 1);
-          return true;
-        } 
+      bool success;
+
+      inode_lock (dir->inode);
+      success = read_names (dir);
+      inode_unlock (dir->inode);
+      if (!success)
+        return false;
     }
-  return false;
+
+  if (dir->pos >= dir->name_cnt)
+    return false;
+  strlcpy (name, dir->names[dir->pos++], NAME_MAX + 1);
+  return true;
 }
@@ -3,14 +3,25 @@
 #include "filesys/inode.h"
 #include "threads/malloc.h"
 
+/* Smallest and largest read-ahead windows, in bytes.  The window
+   opens at the minimum on the first sequential read and doubles
+   with each further one. */
+#define READAHEAD_MIN (2 * BLOCK_SECTOR_SIZE)
+#define READAHEAD_MAX (16 * BLOCK_SECTOR_SIZE)
+
 /* An open file. */
 struct file 
   {
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    off_t ra_next;              /* Where a sequential read would start. */
+    off_t ra_window;            /* Read-ahead window, 0 if not sequential. */
+    off_t ra_end;               /* End of data already read ahead. */
   };
 
+static void readahead (struct file *, off_t offset, off_t size);
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
@@ -69,6 +80,7 @@ off_t
 file_read (struct file *file, void *buffer, off_t size) 
 {
   off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  readahead (file, file->pos, bytes_read);
   file->pos += bytes_read;
   return bytes_read;
 }
@@ -87,9 +99,8 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 /* Writes SIZE bytes from BUFFER into FILE,
    starting at the file's current position.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk is full.
+   Writing past end of file grows the file.
    Advances FILE's position by the number of bytes read. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
@@ -102,9 +113,8 @@ file_write (struct file *file, const void *buffer, off_t size)
 /* Writes SIZE bytes from BUFFER into FILE,
    starting at offset FILE_OFS in the file.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk is full.
+   Writing past end of file grows the file.
    The file's current position is unaffected. */
 off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
@@ -166,3 +176,39 @@ file_tell (struct file *file)
   ASSERT (file != NULL);
   return file->pos;
 }
+
+/* Notes that SIZE bytes were just read from FILE at OFFSET.  If
+   FILE is being read sequentially, widens its read-ahead window
+   and starts reading the data after OFFSET + SIZE into the
+   cache; otherwise closes the window. */
+static void
+readahead (struct file *file, off_t offset, off_t size) 
+{
+  off_t start, end;
+
+  if (size == 0)
+    return;
+
+  if (offset != file->ra_next)
+    {
+      file->ra_window = 0;
+      file->ra_end = 0;
+    }
+  else if (file->ra_window == 0)
+    file->ra_window = READAHEAD_MIN;
+  else if (file->ra_window < READAHEAD_MAX)
+    file->ra_window *= 2;
+  file->ra_next = offset + size;
+
+  if (file->ra_window > 0)
+    {
+      /* Only ask for what previous calls have not. */
+      start = file->ra_end > file->ra_next ? file->ra_end : file->ra_next;
+      end = file->ra_next + file->ra_window;
+      if (start < end)
+        {
+          inode_readahead (file->inode, end - start, start);
+          file->ra_end = end;
+        }
+    }
+}
@@ -1,23 +1,42 @@
 #include "filesys/inode.h"
+#include <hash.h>
 #include <list.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Number of data sectors an inode points to directly. */
+#define DIRECT_CNT 123
+
+/* Number of sector numbers in an indirect block. */
+#define INDIRECT_CNT (BLOCK_SECTOR_SIZE / sizeof (block_sector_t))
+
 /* On-disk inode.
-   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+   Must be exactly BLOCK_SECTOR_SIZE bytes long.
+
+   Data sectors are found through DIRECT_CNT direct pointers,
+   then one indirect block of INDIRECT_CNT pointers, then one
+   doubly indirect block of pointers to indirect blocks.  A
+   pointer of 0 means no sector is allocated; sector 0 always
+   holds the free map inode, so it is never a data sector. */
 struct inode_disk
   {
-    block_sector_t start;               /* First data sector. */
+    block_sector_t direct[DIRECT_CNT];  /* Direct data sectors. */
+    block_sector_t indirect;            /* Indirect block. */
+    block_sector_t doubly_indirect;     /* Doubly indirect block. */
     off_t length;                       /* File size in bytes. */
+    bool is_dir;                        /* True if a directory. */
+    uint8_t unused[3];                  /* Not used. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
   };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -28,17 +47,59 @@ bytes_to_sectors (off_t size)
   return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
 }
 
+/* Key by which open_inodes finds an in-memory inode.  Kept
+   apart from the rest of struct inode so that a lookup key is
+   small enough for the stack. */
+struct inode_key
+  {
+    struct hash_elem elem;              /* Element in open_inodes. */
+    block_sector_t sector;              /* Sector number of disk location. */
+  };
+
 /* In-memory inode. */
 struct inode 
   {
-    struct list_elem elem;              /* Element in inode list. */
-    block_sector_t sector;              /* Sector number of disk location. */
+    struct inode_key key;               /* Sector, and open_inodes element. */
+    struct list_elem closed_elem;       /* Element in closed_inodes. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    struct lock grow_lock;              /* Serializes extending the file. */
+    struct lock lock;                   /* Held by directory operations. */
     struct inode_disk data;             /* Inode content. */
   };
 
+/* Returns entry IDX of the table of sector numbers in sector
+   TABLE, or 0 if TABLE is 0. */
+static block_sector_t
+read_entry (block_sector_t table, size_t idx) 
+{
+  block_sector_t sector;
+
+  if (table == 0)
+    return 0;
+  cache_read (table, &sector, idx * sizeof sector, sizeof sector);
+  return sector;
+}
+
+/* Returns the sector that holds data sector IDX of the file
+   described by DISK, or 0 if none is allocated. */
+static block_sector_t
+index_to_sector (const struct inode_disk *disk, size_t idx) 
+{
+  if (idx < DIRECT_CNT)
+    return disk->direct[idx];
+  idx -= DIRECT_CNT;
+
+  if (idx < INDIRECT_CNT)
+    return read_entry (disk->indirect, idx);
+  idx -= INDIRECT_CNT;
+
+  ASSERT (idx < INDIRECT_CNT * INDIRECT_CNT);
+  return read_entry (read_entry (disk->doubly_indirect, idx / INDIRECT_CNT),
+                     idx % INDIRECT_CNT);
+}
+
 /* Returns the block device sector that contains byte offset POS
    within INODE.
    Returns -1 if INODE does not contain data for a byte at offset
@@ -48,29 +109,199 @@ byte_to_sector (const struct inode *inode, off_t pos)
 {
   ASSERT (inode != NULL);
   if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
+    return index_to_sector (&inode->data, pos / BLOCK_SECTOR_SIZE);
   else
     return -1;
 }
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/* If *SECTORP is 0, allocates a zeroed sector for it, as close
+   after *HINT as possible, and advances *HINT past it.
+   Returns false if the disk is full. */
+static bool
+allocate_sector (block_sector_t *sectorp, block_sector_t *hint) 
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+
+  if (*sectorp != 0)
+    return true;
+  if (!free_map_allocate_near (*hint, sectorp))
+    return false;
+  cache_write (*sectorp, zeros, 0, BLOCK_SECTOR_SIZE);
+  *hint = *sectorp + 1;
+  return true;
+}
+
+/* Like allocate_sector(), for entry IDX of the table of sector
+   numbers in sector TABLE.  Stores the entry into *SECTORP. */
+static bool
+allocate_entry (block_sector_t table, size_t idx,
+                block_sector_t *sectorp, block_sector_t *hint) 
+{
+  *sectorp = read_entry (table, idx);
+  if (*sectorp != 0)
+    return true;
+  if (!allocate_sector (sectorp, hint))
+    return false;
+  cache_write (table, sectorp, idx * sizeof *sectorp, sizeof *sectorp);
+  return true;
+}
+
+/* Makes sure data sector IDX of DISK is allocated, along with
+   any indirect blocks needed to reach it.  New sectors are
+   placed after *HINT if possible.  Returns false if the disk is
+   full or IDX is beyond the largest possible file. */
+static bool
+allocate_index (struct inode_disk *disk, size_t idx, block_sector_t *hint) 
+{
+  block_sector_t indirect, sector;
+
+  if (idx < DIRECT_CNT)
+    return allocate_sector (&disk->direct[idx], hint);
+  idx -= DIRECT_CNT;
+
+  if (idx < INDIRECT_CNT)
+    return (allocate_sector (&disk->indirect, hint)
+            && allocate_entry (disk->indirect, idx, &sector, hint));
+  idx -= INDIRECT_CNT;
+
+  if (idx >= INDIRECT_CNT * INDIRECT_CNT)
+    return false;
+  return (allocate_sector (&disk->doubly_indirect, hint)
+          && allocate_entry (disk->doubly_indirect, idx / INDIRECT_CNT,
+                             &indirect, hint)
+          && allocate_entry (indirect, idx % INDIRECT_CNT, &sector, hint));
+}
+
+/* Allocates zeroed sectors so that DISK can hold LENGTH bytes,
+   without changing DISK->length.  New sectors go right after the
+   file's current last sector when it has one, otherwise after
+   HINT, so that files stay as contiguous as the free map allows.
+   Returns LENGTH if successful.  If the disk fills up, returns
+   the number of bytes DISK can hold with the sectors it has
+   then, which is less than LENGTH; those sectors stay with
+   DISK. */
+static off_t
+extend (struct inode_disk *disk, off_t length, block_sector_t hint) 
+{
+  size_t idx = bytes_to_sectors (disk->length);
+  size_t end = bytes_to_sectors (length);
+
+  if (idx > 0)
+    hint = index_to_sector (disk, idx - 1) + 1;
+  for (; idx < end; idx++)
+    if (!allocate_index (disk, idx, &hint))
+      return idx * BLOCK_SECTOR_SIZE;
+  return length;
+}
+
+/* Releases SECTOR and, if DEPTH > 0, everything reachable from it
+   as a table of sector numbers DEPTH levels deep.  Does nothing
+   if SECTOR is 0. */
+static void
+release_tree (block_sector_t sector, int depth) 
+{
+  size_t i;
+
+  if (sector == 0)
+    return;
+  if (depth > 0)
+    for (i = 0; i < INDIRECT_CNT; i++)
+      release_tree (read_entry (sector, i), depth - 1);
+  free_map_release (sector, 1);
+}
+
+/* Releases every sector DISK points to, directly or not. */
+static void
+deallocate (struct inode_disk *disk) 
+{
+  size_t i;
+
+  for (i = 0; i < DIRECT_CNT; i++)
+    release_tree (disk->direct[i], 0);
+  release_tree (disk->indirect, 1);
+  release_tree (disk->doubly_indirect, 2);
+}
+
+/* Open inodes, hashed by sector, so that opening a single
+   inode twice returns the same `struct inode'.  Also holds the
+   inodes in closed_inodes. */
+static struct hash open_inodes;
+
+/* Recently closed inodes, most recently closed first.  These
+   stay in open_inodes with an open_cnt of 0, so that reopening a
+   file that was just closed does not have to read its disk
+   inode again. */
+#define CLOSED_INODES_MAX 16
+static struct list closed_inodes;
+static size_t closed_inode_cnt;
+
+/* Protects open_inodes and closed_inodes.  Lookups of inodes
+   that are already open only read them, so they may run
+   concurrently. */
+static struct rw_lock open_inodes_lock;
+
+static hash_hash_func inode_hash;
+static hash_less_func inode_less;
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
-  list_init (&open_inodes);
+  hash_init (&open_inodes, inode_hash, inode_less, NULL);
+  list_init (&closed_inodes);
+  rw_lock_init (&open_inodes_lock);
+}
+
+/* Returns a hash value for inode key E. */
+static unsigned
+inode_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct inode_key, elem)->sector);
+}
+
+/* Returns true if inode key A precedes inode key B. */
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct inode_key, elem)->sector
+          < hash_entry (b, struct inode_key, elem)->sector);
+}
+
+/* Returns the in-memory inode for SECTOR, which may be open or
+   recently closed, or a null pointer if there is none.
+   open_inodes_lock must be held. */
+static struct inode *
+find_inode (block_sector_t sector)
+{
+  struct inode_key key;
+  struct hash_elem *e;
+
+  key.sector = sector;
+  e = hash_find (&open_inodes, &key.elem);
+  return e != NULL ? hash_entry (e, struct inode, key.elem) : NULL;
+}
+
+/* Reopens INODE, which may be recently closed, and returns it.
+   open_inodes_lock must be held for writing. */
+static struct inode *
+revive_inode (struct inode *inode)
+{
+  if (inode->open_cnt == 0)
+    {
+      list_remove (&inode->closed_elem);
+      closed_inode_cnt--;
+    }
+  return inode_reopen (inode);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   device.
+   device.  The inode is marked as a directory if IS_DIR.
    Returns true if successful.
    Returns false if memory or disk allocation fails. */
 bool
-inode_create (block_sector_t sector, off_t length)
+inode_create (block_sector_t sector, off_t length, bool is_dir)
 {
   struct inode_disk *disk_inode = NULL;
   bool success = false;
@@ -84,22 +315,16 @@ inode_create (block_sector_t sector, off_t length)
   disk_inode = calloc (1, sizeof *disk_inode);
   if (disk_inode != NULL)
     {
-      size_t sectors = bytes_to_sectors (length);
-      disk_inode->length = length;
+      disk_inode->is_dir = is_dir;
       disk_inode->magic = INODE_MAGIC;
-      if (free_map_allocate (sectors, &disk_inode->start)) 
+      if (extend (disk_inode, length, sector + 1) == length) 
         {
-          block_write (fs_device, sector, disk_inode);
-          if (sectors > 0) 
-            {
-              static char zeros[BLOCK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
-            }
+          disk_inode->length = length;
+          cache_write (sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
           success = true; 
         } 
+      else
+        deallocate (disk_inode);
       free (disk_inode);
     }
   return success;
@@ -111,20 +336,28 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
   struct inode *inode;
 
-  /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
-    {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
-    }
+  /* Check whether this inode is already open.  Reviving a
+     recently closed inode changes closed_inodes, which needs the
+     lock for writing. */
+  rw_lock_acquire_read (&open_inodes_lock);
+  inode = find_inode (sector);
+  if (inode != NULL && inode->open_cnt > 0)
+    inode_reopen (inode);
+  else
+    inode = NULL;
+  rw_lock_release_read (&open_inodes_lock);
+  if (inode != NULL)
+    return inode;
+
+  rw_lock_acquire_write (&open_inodes_lock);
+  inode = find_inode (sector);
+  if (inode != NULL)
+    revive_inode (inode);
+  rw_lock_release_write (&open_inodes_lock);
+  if (inode != NULL)
+    return inode;
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
@@ -132,12 +365,28 @@ inode_open (block_sector_t sector)
     return NULL;
 
   /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
-  inode->sector = sector;
+  inode->key.sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  lock_init (&inode->grow_lock);
+  lock_init (&inode->lock);
+  cache_read (inode->key.sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
+
+  /* Another thread may have opened the same inode while we were
+     reading it in.  If so, use theirs. */
+  rw_lock_acquire_write (&open_inodes_lock);
+  struct inode *other = find_inode (sector);
+  if (other != NULL)
+    revive_inode (other);
+  else
+    hash_insert (&open_inodes, &inode->key.elem);
+  rw_lock_release_write (&open_inodes_lock);
+  if (other != NULL)
+    {
+      free (inode);
+      return other;
+    }
   return inode;
 }
 
@@ -146,7 +395,12 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      /* Readers of open_inodes may reopen concurrently. */
+      enum intr_level old_level = intr_disable ();
+      inode->open_cnt++;
+      intr_set_level (old_level);
+    }
   return inode;
 }
 
@@ -154,34 +408,58 @@ inode_reopen (struct inode *inode)
 block_sector_t
 inode_get_inumber (const struct inode *inode)
 {
-  return inode->sector;
+  return inode->key.sector;
 }
 
 /* Closes INODE and writes it to disk.
-   If this was the last reference to INODE, frees its memory.
-   If INODE was also a removed inode, frees its blocks. */
+   If this was the last reference to INODE and INODE was removed,
+   frees its blocks and its memory.  Otherwise the last close
+   keeps INODE in memory among the recently closed inodes, freeing
+   the least recently closed one if there are too many. */
 void
 inode_close (struct inode *inode) 
 {
+  struct inode *victim = NULL;
+
   /* Ignore null pointer. */
   if (inode == NULL)
     return;
 
-  /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  rw_lock_acquire_write (&open_inodes_lock);
+  enum intr_level old_level = intr_disable ();
+  bool last = --inode->open_cnt == 0;
+  intr_set_level (old_level);
+  if (last)
+    {
+      if (inode->removed)
+        {
+          hash_delete (&open_inodes, &inode->key.elem);
+          victim = inode;
+        }
+      else 
+        {
+          list_push_front (&closed_inodes, &inode->closed_elem);
+          if (++closed_inode_cnt > CLOSED_INODES_MAX)
+            {
+              victim = list_entry (list_pop_back (&closed_inodes),
+                                   struct inode, closed_elem);
+              closed_inode_cnt--;
+              hash_delete (&open_inodes, &victim->key.elem);
+            }
+        }
+    }
+  rw_lock_release_write (&open_inodes_lock);
+
+  if (victim != NULL)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
- 
       /* Deallocate blocks if removed. */
-      if (inode->removed) 
+      if (victim->removed) 
         {
-          free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
+          deallocate (&victim->data);
+          free_map_release (victim->key.sector, 1);
         }
 
-      free (inode); 
+      free (victim); 
     }
 }
 
@@ -194,6 +472,20 @@ inode_remove (struct inode *inode)
   inode->removed = true;
 }
 
+/* Returns true if INODE has been removed. */
+bool
+inode_is_removed (const struct inode *inode)
+{
+  return inode->removed;
+}
+
+/* Returns true if INODE is a directory. */
+bool
+inode_is_dir (const struct inode *inode)
+{
+  return inode->data.is_dir;
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
    than SIZE if an error occurs or end of file is reached. */
@@ -202,7 +494,6 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
 
   while (size > 0) 
     {
@@ -220,59 +511,85 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
-        }
-      else 
-        {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          block_read (fs_device, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-        }
+      cache_read (sector_idx, buffer + bytes_read, sector_ofs, chunk_size);
       
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
 
   return bytes_read;
 }
 
+/* Starts reading SIZE bytes of INODE, starting at OFFSET, into
+   the buffer cache in the background.  Bytes past the end of
+   INODE are ignored. */
+void
+inode_readahead (struct inode *inode, off_t size, off_t offset) 
+{
+  off_t length = inode_length (inode);
+  off_t end = offset + size < length ? offset + size : length;
+
+  for (offset -= offset % BLOCK_SECTOR_SIZE; offset < end;
+       offset += BLOCK_SECTOR_SIZE)
+    cache_readahead (byte_to_sector (inode, offset));
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the disk is full or an error occurs.
+   A write past end of file extends the inode, filling any gap
+   with zeros. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset) 
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
+  off_t length;
+  bool growing = false;
 
   if (inode->deny_write_cnt)
     return 0;
 
+  /* Allocate space for data past end of file.  The new length
+     becomes visible only once the data is written.  Writes that
+     stay inside the file need no lock of their own, since the
+     buffer cache locks each sector.
+
+     If the disk fills up partway, write as much as fits in the
+     sectors that were allocated, as a short write.  Sectors past
+     the end of what is written stay with the inode, recorded on
+     disk, for the next attempt to reuse or inode removal to
+     free. */
+  length = inode_length (inode);
+  if (offset + size > length)
+    {
+      lock_acquire (&inode->grow_lock);
+      growing = true;
+      length = inode_length (inode);
+      if (offset + size > length)
+        {
+          off_t reached = extend (&inode->data, offset + size,
+                                  inode->key.sector + 1);
+          if (reached > offset)
+            length = reached;
+          if (reached < offset + size)
+            cache_write (inode->key.sector, &inode->data,
+                         0, BLOCK_SECTOR_SIZE);
+        }
+    }
+
   while (size > 0) 
     {
       /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      block_sector_t sector_idx = index_to_sector (&inode->data,
+                                                   offset / BLOCK_SECTOR_SIZE);
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      off_t inode_left = length - offset;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -281,38 +598,23 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
-        }
-      else 
-        {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
-        }
+      cache_write (sector_idx, buffer + bytes_written, sector_ofs, chunk_size);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
+
+  if (growing)
+    {
+      if (length > inode->data.length)
+        {
+          inode->data.length = length;
+          cache_write (inode->key.sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
+        }
+      lock_release (&inode->grow_lock);
+    }
 
   return bytes_written;
 }
@@ -322,8 +624,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 void
 inode_deny_write (struct inode *inode) 
 {
+  lock_acquire (&inode->grow_lock);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  lock_release (&inode->grow_lock);
 }
 
 /* Re-enables writes to INODE.
@@ -332,9 +636,11 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  lock_acquire (&inode->grow_lock);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  lock_release (&inode->grow_lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -343,3 +649,19 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Acquires INODE's lock.  Directory operations hold it so that
+   looking up, adding and removing entries are atomic with
+   respect to each other. */
+void
+inode_lock (struct inode *inode) 
+{
+  lock_acquire (&inode->lock);
+}
+
+/* Releases INODE's lock. */
+void
+inode_unlock (struct inode *inode) 
+{
+  lock_release (&inode->lock);
+}
@@ -0,0 +1,42 @@
+#ifndef __LIB_IOSTAT_H
+#define __LIB_IOSTAT_H
+
+#include <stdint.h>
+
+/* Block device I/O statistics, as kept by the kernel and
+   returned by the iostat() system call.  Times are in CPU
+   cycles. */
+
+/* Buckets in a latency histogram.  Bucket I counts requests that
+   took from 2**I to 2**(I+1) - 1 cycles, except that the last
+   bucket also counts anything slower. */
+#define IOSTAT_BUCKETS 40
+
+/* Statistics for reads or for writes. */
+struct iostat_dir
+  {
+    uint64_t sector_cnt;        /* Sectors requested. */
+    uint64_t request_cnt;       /* Requests completed. */
+    uint64_t queue_cycles;      /* Total time from submission to dispatch. */
+    uint64_t service_cycles;    /* Total time in the driver. */
+    uint32_t latency[IOSTAT_BUCKETS];   /* Requests by total time. */
+  };
+
+/* Statistics for a block device.  A partition's requests are
+   counted both for the partition and for its disk, but only the
+   disk issues commands and takes the channel lock. */
+struct iostat
+  {
+    char name[16];              /* Device name, e.g. "hda1". */
+    char type[16];              /* Device type, e.g. "filesys". */
+    struct iostat_dir dir[2];   /* Reads, then writes. */
+    uint32_t max_depth;         /* Most requests outstanding at once. */
+    uint64_t depth_sum;         /* Requests outstanding, summed over
+                                   every submission. */
+    uint64_t command_cnt;       /* Commands issued to the driver. */
+    uint64_t lock_cnt;          /* Channel lock acquisitions. */
+    uint64_t lock_contended_cnt; /* Acquisitions that had to wait. */
+    uint64_t lock_wait_cycles;  /* Total time waiting for the lock. */
+  };
+
+#endif /* lib/iostat.h */
@@ -3,6 +3,7 @@
 #include <limits.h>
 #include <round.h>
 #include <stdio.h>
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 #ifdef FILESYS
 #include "filesys/file.h"
@@ -28,8 +29,18 @@ struct bitmap
   {
     size_t bit_cnt;     /* Number of bits. */
     elem_type *bits;    /* Elements that represent bits. */
+    size_t hint;        /* Every bit before this one is true. */
+    unsigned free_gen;  /* Incremented whenever a bit may become false. */
   };
 
+/* The hint is a low-water mark for searches for false bits.
+   Bits may be freed concurrently with a search, even from code
+   that holds no lock (palloc_free_multiple(), for one), so the
+   hint is only ever lowered, with interrupts off, when a bit may
+   become false.  A search raises it only if no bit could have
+   become false since the search read it, which it detects by
+   FREE_GEN being unchanged. */
+
 /* Returns the index of the element that contains the bit
    numbered BIT_IDX. */
 static inline size_t
@@ -69,6 +80,13 @@ last_mask (const struct bitmap *b)
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns the index of the lowest set bit in nonzero ELEM. */
+static inline size_t
+first_set (elem_type elem) 
+{
+  return __builtin_ctzl (elem);
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -82,6 +100,8 @@ bitmap_create (size_t bit_cnt)
   if (b != NULL)
     {
       b->bit_cnt = bit_cnt;
+      b->hint = 0;
+      b->free_gen = 0;
       b->bits = malloc (byte_cnt (bit_cnt));
       if (b->bits != NULL || bit_cnt == 0)
         {
@@ -104,6 +124,8 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
   ASSERT (block_size >= bitmap_buf_size (bit_cnt));
 
   b->bit_cnt = bit_cnt;
+  b->hint = 0;
+  b->free_gen = 0;
   b->bits = (elem_type *) (b + 1);
   bitmap_set_all (b, false);
   return b;
@@ -141,6 +163,19 @@ bitmap_size (const struct bitmap *b)
 
 /* Setting and testing single bits. */
 
+/* Notes that bit BIT_IDX in B may be about to become false, by
+   lowering B's hint to it if necessary.  Interrupts must be
+   off. */
+static void
+lower_hint (struct bitmap *b, size_t bit_idx)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (bit_idx < b->hint)
+    b->hint = bit_idx;
+  b->free_gen++;
+}
+
 /* Atomically sets the bit numbered IDX in B to VALUE. */
 void
 bitmap_set (struct bitmap *b, size_t idx, bool value) 
@@ -172,11 +207,18 @@ bitmap_reset (struct bitmap *b, size_t bit_idx)
 {
   size_t idx = elem_idx (bit_idx);
   elem_type mask = bit_mask (bit_idx);
+  enum intr_level old_level;
+
+  /* Lower the hint along with clearing the bit, so that no
+     search sees one without the other. */
+  old_level = intr_disable ();
+  lower_hint (b, bit_idx);
 
   /* This is equivalent to `b->bits[idx] &= ~mask' except that it
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the AND instruction in [IA32-v2a]. */
   asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+  intr_set_level (old_level);
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -187,11 +229,16 @@ bitmap_flip (struct bitmap *b, size_t bit_idx)
 {
   size_t idx = elem_idx (bit_idx);
   elem_type mask = bit_mask (bit_idx);
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  lower_hint (b, bit_idx);
 
   /* This is equivalent to `b->bits[idx] ^= mask' except that it
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the XOR instruction in [IA32-v2b]. */
   asm ("xorl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  intr_set_level (old_level);
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -289,6 +336,65 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 
 /* Finding set or unset bits. */
 
+/* Scans B for a group of CNT consecutive bits set to VALUE, as
+   for bitmap_scan(), where CNT is nonzero.  Stores into *FIRST
+   the index of the first bit at or after START that is set to
+   VALUE, or B's size if there is none.
+
+   Each step consumes a whole run of equal bits within one
+   element, found with first_set(), so a scan costs time in
+   proportion to the number of runs, not of bits. */
+static size_t
+scan (const struct bitmap *b, size_t start, size_t cnt, bool value,
+      size_t *first) 
+{
+  size_t run = 0;       /* Length of run of VALUE bits before I. */
+  size_t i = start;
+
+  *first = b->bit_cnt;
+  while (i < b->bit_cnt)
+    {
+      size_t ofs = i % ELEM_BITS;
+      size_t avail = ELEM_BITS - ofs;
+      elem_type elem, mask;
+      size_t len;
+
+      /* Take the bits of I's element from I onward, with VALUE
+         bits as 1s, shifted down so that bit I is bit 0. */
+      if (avail > b->bit_cnt - i)
+        avail = b->bit_cnt - i;
+      mask = avail < ELEM_BITS ? ((elem_type) 1 << avail) - 1 : (elem_type) -1;
+      elem = b->bits[elem_idx (i)];
+      elem = ((value ? elem : ~elem) >> ofs) & mask;
+
+      if (elem & 1)
+        {
+          if (*first == b->bit_cnt)
+            *first = i;
+          len = elem == mask ? avail : first_set (~elem);
+          run += len;
+          if (run >= cnt)
+            return i + len - run;
+        }
+      else
+        {
+          len = elem == 0 ? avail : first_set (elem);
+          run = 0;
+        }
+      i += len;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Returns where a search of B for bits set to VALUE that would
+   begin at START may begin instead.  Every bit of B before its
+   hint is true, so a search for false bits can skip them. */
+static inline size_t
+skip_ahead (const struct bitmap *b, size_t start, bool value) 
+{
+  return !value && start < b->hint ? b->hint : start;
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
@@ -296,36 +402,59 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
+  size_t first;
+
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
-    {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
-    }
-  return BITMAP_ERROR;
+  if (cnt == 0)
+    return start;
+  return scan (b, skip_ahead (b, start, value), cnt, value, &first);
 }
 
 /* Finds the first group of CNT consecutive bits in B at or after
    START that are all set to VALUE, flips them all to !VALUE,
    and returns the index of the first bit in the group.
    If there is no such group, returns BITMAP_ERROR.
-   If CNT is zero, returns 0.
+   If CNT is zero, returns START.
    Bits are set atomically, but testing bits is not atomic with
-   setting them. */
+   setting them, so callers that flip bits to true must serialize
+   with each other.  Bits may be set to false concurrently: the
+   hint stays correct regardless. */
 size_t
 bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value)
 {
-  size_t idx = bitmap_scan (b, start, cnt, value);
+  enum intr_level old_level;
+  size_t idx, first;
+  unsigned gen;
+
+  ASSERT (b != NULL);
+  ASSERT (start <= b->bit_cnt);
+
+  if (cnt == 0)
+    return start;
+
+  old_level = intr_disable ();
+  gen = b->free_gen;
+  start = skip_ahead (b, start, value);
+  intr_set_level (old_level);
+
+  idx = scan (b, start, cnt, value, &first);
   if (idx != BITMAP_ERROR) 
     bitmap_set_multiple (b, idx, cnt, !value);
+
+  /* A search for false bits that began at the hint found every
+     bit before FIRST true, and if the group began at FIRST, it
+     is now true as well.  That no longer holds if any bit may
+     have become false meanwhile, since it may have been one the
+     search had already passed. */
+  old_level = intr_disable ();
+  if (!value && start == b->hint && gen == b->free_gen)
+    b->hint = idx == first ? idx + cnt : first;
+  intr_set_level (old_level);
   return idx;
 }
-
+
 /* File input and output. */
 
 #ifdef FILESYS
@@ -347,6 +476,8 @@ bitmap_read (struct bitmap *b, struct file *file)
       off_t size = byte_cnt (b->bit_cnt);
       success = file_read_at (file, b->bits, size, 0) == size;
       b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+      b->hint = 0;
+      b->free_gen++;
     }
   return success;
 }
@@ -359,6 +490,23 @@ bitmap_write (const struct bitmap *b, struct file *file)
   off_t size = byte_cnt (b->bit_cnt);
   return file_write_at (file, b->bits, size, 0) == size;
 }
+
+/* Writes the part of B that bitmap_write() would write to bytes
+   OFS through OFS + SIZE of FILE, clipped to the end of B.
+   Return true if successful, false otherwise. */
+bool
+bitmap_write_part (const struct bitmap *b, struct file *file,
+                   off_t ofs, off_t size)
+{
+  off_t file_size = byte_cnt (b->bit_cnt);
+
+  if (ofs >= file_size)
+    return true;
+  if (size > file_size - ofs)
+    size = file_size - ofs;
+  return (file_write_at (file, (const uint8_t *) b->bits + ofs, size, ofs)
+          == size);
+}
 #endif /* FILESYS */
 
 /* Debugging. */
@@ -1,6 +1,11 @@
 #ifndef __LIB_KERNEL_CONSOLE_H
 #define __LIB_KERNEL_CONSOLE_H
 
+#include <stdbool.h>
+
+/* Whether console output is mirrored to the VGA display. */
+extern bool console_use_vga;
+
 void console_init (void);
 void console_panic (void);
 void console_print_stats (void);
@@ -0,0 +1,245 @@
+#include <klog.h>
+#include <console.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Kernel log.
+
+   klog() is like printf(), except that instead of writing to the
+   console it appends the message, stamped with the timer tick
+   count, to an in-memory ring that a low-priority kernel thread
+   drains to the console in the background.  It takes no locks
+   and does not disable interrupts, so it may be called from any
+   context: interrupt handlers, the scheduler, the page fault
+   handler, or code that holds the console lock.
+
+   Writers claim space in the ring by advancing ring_head with an
+   atomic compare-and-swap, then fill in their record and finally
+   mark it committed.  The drainer consumes committed records in
+   order from ring_tail, zeroing each one before giving its space
+   back, so that a newly claimed record is never mistaken for a
+   committed one.  A message that finds the ring full is dropped
+   and counted.
+
+   On panic, console_panic() calls klog_panic() to write out
+   whatever the drainer had not yet gotten to. */
+
+/* Ring size in bytes.  Must be a power of 2. */
+#define RING_SIZE 16384
+
+/* Longest message kept; longer ones are truncated. */
+#define MSG_MAX 256
+
+/* Ticks between drains by the drain thread. */
+#define DRAIN_TICKS (TIMER_FREQ / 10)
+
+/* Start of a record in the ring, followed by the message text.
+   Records are padded to a multiple of 4 bytes, so the COMMITTED
+   word is always aligned, even when a record wraps around the
+   end of the ring. */
+struct record
+  {
+    uint32_t len;               /* Length of message text. */
+    uint32_t committed;         /* Nonzero once text is complete. */
+    int64_t ticks;              /* Timer ticks when logged. */
+  };
+
+/* The ring.  ring_head and ring_tail only ever increase, so
+   their difference is the number of bytes in use.  Only writers
+   advance ring_head, only the drainer advances ring_tail. */
+static uint8_t ring[RING_SIZE] __attribute__ ((aligned (4)));
+static volatile uint32_t ring_head;
+static volatile uint32_t ring_tail;
+
+/* Serializes threads that drain the ring. */
+static struct lock drain_lock;
+
+/* Statistics. */
+static volatile uint32_t logged_cnt;    /* # of messages logged. */
+static volatile uint32_t dropped_cnt;   /* # of messages dropped. */
+
+static thread_func drain_thread;
+static void drain (void);
+
+/* Starts the thread that drains the log to the console.  Must be
+   called after thread_start().  Messages logged before then are
+   kept in the ring until the thread first runs. */
+void
+klog_init (void)
+{
+  lock_init (&drain_lock);
+  if (thread_create ("klog", PRI_MIN, drain_thread, NULL) == TID_ERROR)
+    PANIC ("klog_init: can't create drain thread");
+}
+
+/* Copies SIZE bytes from SRC into the ring starting at POS,
+   wrapping around its end if necessary. */
+static void
+ring_write (uint32_t pos, const void *src_, size_t size)
+{
+  const uint8_t *src = src_;
+  size_t ofs = pos % RING_SIZE;
+  size_t first = size < RING_SIZE - ofs ? size : RING_SIZE - ofs;
+
+  memcpy (ring + ofs, src, first);
+  memcpy (ring, src + first, size - first);
+}
+
+/* Copies SIZE bytes from the ring starting at POS into DST,
+   wrapping around its end if necessary. */
+static void
+ring_read (uint32_t pos, void *dst_, size_t size)
+{
+  uint8_t *dst = dst_;
+  size_t ofs = pos % RING_SIZE;
+  size_t first = size < RING_SIZE - ofs ? size : RING_SIZE - ofs;
+
+  memcpy (dst, ring + ofs, first);
+  memcpy (dst + first, ring, size - first);
+}
+
+/* Zeroes SIZE bytes of the ring starting at POS. */
+static void
+ring_clear (uint32_t pos, size_t size)
+{
+  size_t ofs = pos % RING_SIZE;
+  size_t first = size < RING_SIZE - ofs ? size : RING_SIZE - ofs;
+
+  memset (ring + ofs, 0, first);
+  memset (ring, 0, size - first);
+}
+
+/* Returns the address of the COMMITTED word of the record that
+   starts at POS. */
+static volatile uint32_t *
+committed_word (uint32_t pos)
+{
+  return (volatile uint32_t *)
+    (ring + (pos + offsetof (struct record, committed)) % RING_SIZE);
+}
+
+/* Returns the number of ring bytes taken by a record with LEN
+   bytes of text. */
+static uint32_t
+record_size (uint32_t len)
+{
+  return ROUND_UP (sizeof (struct record) + len, 4);
+}
+
+/* Formats a message as for printf() and appends it to the
+   kernel log.  May be called from any context. */
+void
+klog (const char *format, ...)
+{
+  char text[MSG_MAX];
+  struct record r;
+  uint32_t head, size;
+  va_list args;
+  int len;
+
+  r.ticks = timer_ticks ();
+  va_start (args, format);
+  len = vsnprintf (text, sizeof text, format, args);
+  va_end (args);
+  r.len = len < (int) sizeof text ? len : (int) sizeof text - 1;
+  r.committed = 0;
+  size = record_size (r.len);
+
+  /* Claim SIZE bytes of the ring. */
+  do
+    {
+      head = ring_head;
+      if (head + size - ring_tail > RING_SIZE)
+        {
+          __sync_fetch_and_add (&dropped_cnt, 1);
+          return;
+        }
+    }
+  while (!__sync_bool_compare_and_swap (&ring_head, head, head + size));
+
+  ring_write (head, &r, sizeof r);
+  ring_write (head + sizeof r, text, r.len);
+  barrier ();
+  *committed_word (head) = 1;
+  __sync_fetch_and_add (&logged_cnt, 1);
+}
+
+/* Writes everything logged so far to the console.  Must be
+   called from a kernel thread, after klog_init(). */
+void
+klog_flush (void)
+{
+  ASSERT (!intr_context ());
+
+  lock_acquire (&drain_lock);
+  drain ();
+  lock_release (&drain_lock);
+}
+
+/* Writes everything logged so far to the console, without
+   taking any locks.  For use only when the kernel is panicking,
+   when nothing else will drain the ring again. */
+void
+klog_panic (void)
+{
+  drain ();
+}
+
+/* Writes every committed record at the tail of the ring to the
+   console and frees its space.  Stops at the first record whose
+   writer has not yet finished. */
+static void
+drain (void)
+{
+  for (;;)
+    {
+      char text[MSG_MAX];
+      struct record r;
+      uint32_t tail = ring_tail;
+      uint32_t size;
+
+      if (tail == ring_head || *committed_word (tail) == 0)
+        break;
+      barrier ();
+      ring_read (tail, &r, sizeof r);
+      ring_read (tail + sizeof r, text, r.len);
+      size = record_size (r.len);
+      if (r.len > 0 && text[r.len - 1] == '\n')
+        r.len--;
+
+      ring_clear (tail, size);
+      barrier ();
+      ring_tail = tail + size;
+
+      printf ("[%"PRId64"] ", r.ticks);
+      putbuf (text, r.len);
+      putchar ('\n');
+    }
+}
+
+/* Drains the log to the console every DRAIN_TICKS. */
+static void
+drain_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      klog_flush ();
+      timer_sleep (DRAIN_TICKS);
+    }
+}
+
+/* Prints kernel log statistics. */
+void
+klog_print_stats (void)
+{
+  printf ("Klog: %"PRIu32" messages logged, %"PRIu32" dropped\n",
+          logged_cnt, dropped_cnt);
+}
@@ -0,0 +1,12 @@
+#ifndef __LIB_KERNEL_KLOG_H
+#define __LIB_KERNEL_KLOG_H
+
+#include <debug.h>
+
+void klog_init (void);
+void klog (const char *format, ...) PRINTF_FORMAT (1, 2);
+void klog_flush (void);
+void klog_panic (void);
+void klog_print_stats (void);
+
+#endif /* lib/kernel/klog.h */
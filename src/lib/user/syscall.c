@@ -182,3 +182,9 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+bool
+iostat (int idx, struct iostat *stats)
+{
+  return syscall2 (SYS_IOSTAT, idx, stats);
+}
@@ -53,6 +53,13 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"rwlock-readers", test_rwlock_readers},
+    {"rwlock-writer-pref", test_rwlock_writer_pref},
+    {"rwlock-priority", test_rwlock_priority},
+    {"spawn-rate", test_spawn_rate},
+    {"workqueue", test_workqueue},
+    {"block-submit", test_block_submit},
+    {"klog", test_klog},
   };  
 #endif
 
@@ -37,6 +37,13 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_rwlock_readers;
+extern test_func test_rwlock_writer_pref;
+extern test_func test_rwlock_priority;
+extern test_func test_spawn_rate;
+extern test_func test_workqueue;
+extern test_func test_block_submit;
+extern test_func test_klog;
 #endif
 
 void msg (const char *, ...);
@@ -0,0 +1,58 @@
+/* Creates enough files in the root directory that it must grow
+   several times, then checks that each can be found, removes
+   every other one, and checks the rest are still there. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 200
+
+void
+test_main (void) 
+{
+  char name[16];
+  int i;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+  msg ("created %d files", FILE_CNT);
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "file%d", i);
+      fd = open (name);
+      if (fd < 2)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+  msg ("opened %d files", FILE_CNT);
+
+  for (i = 0; i < FILE_CNT; i += 2)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "file%d", i);
+      fd = open (name);
+      if (i % 2 == 0 && fd != -1)
+        fail ("open \"%s\" succeeded after removal", name);
+      if (i % 2 != 0 && fd < 2)
+        fail ("open \"%s\" failed after removals", name);
+      if (fd != -1)
+        close (fd);
+    }
+  msg ("removed every other file");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-many) begin
+(dir-many) created 200 files
+(dir-many) opened 200 files
+(dir-many) removed every other file
+(dir-many) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Builds a small directory tree, moves around it with chdir(),
+   and checks that relative and absolute paths, readdir(),
+   isdir() and inumber() agree, and that only empty directories
+   can be removed. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char name[READDIR_MAX_LEN + 1];
+  int fd1, fd2;
+
+  CHECK (mkdir ("a"), "mkdir \"a\"");
+  CHECK (mkdir ("/a/b"), "mkdir \"/a/b\"");
+  CHECK (!mkdir ("a/b"), "mkdir \"a/b\" again (must fail)");
+  CHECK (chdir ("a/b"), "chdir \"a/b\"");
+  CHECK (create ("f", 0), "create \"f\"");
+  CHECK (chdir ("/"), "chdir \"/\"");
+
+  CHECK ((fd1 = open ("/a/b/f")) > 1, "open \"/a/b/f\"");
+  CHECK ((fd2 = open ("a/./b/../b//f")) > 1, "open \"a/./b/../b//f\"");
+  if (inumber (fd1) != inumber (fd2))
+    fail ("\"/a/b/f\" and \"a/./b/../b//f\" differ");
+  if (isdir (fd1))
+    fail ("\"/a/b/f\" is a directory");
+  close (fd2);
+  close (fd1);
+
+  CHECK ((fd1 = open ("a/b")) > 1, "open \"a/b\"");
+  if (!isdir (fd1))
+    fail ("\"a/b\" is not a directory");
+  CHECK (readdir (fd1, name), "readdir \"a/b\"");
+  if (strcmp (name, "f"))
+    fail ("readdir returned \"%s\" instead of \"f\"", name);
+  CHECK (!readdir (fd1, name), "readdir \"a/b\" at end (must fail)");
+  close (fd1);
+
+  CHECK (!remove ("a"), "remove \"a\" (must fail)");
+  CHECK (remove ("a/b/f"), "remove \"a/b/f\"");
+  CHECK (remove ("a/b"), "remove \"a/b\"");
+  CHECK (remove ("a"), "remove \"a\"");
+  CHECK (open ("a") == -1, "open \"a\" (must return -1)");
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-tree) begin
+(dir-tree) mkdir "a"
+(dir-tree) mkdir "/a/b"
+(dir-tree) mkdir "a/b" again (must fail)
+(dir-tree) chdir "a/b"
+(dir-tree) create "f"
+(dir-tree) chdir "/"
+(dir-tree) open "/a/b/f"
+(dir-tree) open "a/./b/../b//f"
+(dir-tree) open "a/b"
+(dir-tree) readdir "a/b"
+(dir-tree) readdir "a/b" at end (must fail)
+(dir-tree) remove "a" (must fail)
+(dir-tree) remove "a/b/f"
+(dir-tree) remove "a/b"
+(dir-tree) remove "a"
+(dir-tree) open "a" (must return -1)
+(dir-tree) end
+EOF
+pass;
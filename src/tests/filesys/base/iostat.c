@@ -0,0 +1,37 @@
+/* Checks that the iostat system call reports the file system
+   device, which must have read the sectors that loaded this
+   program, and that it fails past the last device. */
+
+#include <iostat.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct iostat stats;
+  uint64_t latency_cnt;
+  int dev_cnt, fs_idx;
+  int i;
+
+  fs_idx = -1;
+  for (dev_cnt = 0; iostat (dev_cnt, &stats); dev_cnt++)
+    if (fs_idx < 0 && !strcmp (stats.type, "filesys"))
+      fs_idx = dev_cnt;
+  CHECK (fs_idx >= 0, "find file system device");
+
+  CHECK (iostat (fs_idx, &stats), "iostat file system device");
+  CHECK (stats.dir[0].sector_cnt > 0 && stats.dir[0].request_cnt > 0,
+         "file system device has read sectors");
+
+  latency_cnt = 0;
+  for (i = 0; i < IOSTAT_BUCKETS; i++)
+    latency_cnt += stats.dir[0].latency[i];
+  CHECK (latency_cnt == stats.dir[0].request_cnt,
+         "read latencies add up to read requests");
+
+  CHECK (!iostat (dev_cnt, &stats), "iostat past last device (must fail)");
+  CHECK (!iostat (-1, &stats), "iostat (-1) (must fail)");
+}
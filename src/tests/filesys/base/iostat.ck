@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(iostat) begin
+(iostat) find file system device
+(iostat) iostat file system device
+(iostat) file system device has read sectors
+(iostat) read latencies add up to read requests
+(iostat) iostat past last device (must fail)
+(iostat) iostat (-1) (must fail)
+(iostat) end
+EOF
+pass;
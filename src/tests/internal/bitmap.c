@@ -0,0 +1,136 @@
+/* Test program and microbenchmark for searching in
+   lib/kernel/bitmap.c.
+
+   Checks bitmap_scan() and bitmap_scan_and_flip() against a
+   simple bit-at-a-time search on random bitmaps, then times
+   filling and refilling a large bitmap the way palloc and the
+   free map do.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <random.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Largest bitmap checked for correctness, in bits. */
+#define MAX_BITS 300
+
+/* Size of the bitmap used for timing, in bits: one per sector
+   of a 16 MB disk. */
+#define BENCH_BITS 32768
+
+static size_t slow_scan (const struct bitmap *, size_t start, size_t cnt,
+                         bool);
+static void verify_scans (void);
+static void bench (void);
+
+/* Test and time the bitmap search implementation. */
+void
+test (void)
+{
+  verify_scans ();
+  bench ();
+  printf ("done\n");
+}
+
+/* Returns what bitmap_scan() should: the first group of CNT bits
+   set to VALUE at or after START, found one bit at a time. */
+static size_t
+slow_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
+{
+  size_t i, j;
+
+  if (cnt == 0)
+    return start;
+  for (i = start; i + cnt <= bitmap_size (b); i++)
+    {
+      for (j = 0; j < cnt; j++)
+        if (bitmap_test (b, i + j) != value)
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Checks searches of random bitmaps against slow_scan(),
+   interleaving them with allocations and frees so that the
+   search hint is exercised too. */
+static void
+verify_scans (void)
+{
+  int iter;
+
+  printf ("testing bitmap searches:");
+  for (iter = 0; iter < 2000; iter++)
+    {
+      struct bitmap *b = bitmap_create (random_ulong () % MAX_BITS);
+      size_t size = bitmap_size (b);
+      int density = random_ulong () % 4;
+      size_t i;
+      int op;
+
+      ASSERT (b != NULL);
+      for (i = 0; i < size; i++)
+        bitmap_set (b, i, random_ulong () % 4 < (unsigned) density);
+
+      for (op = 0; op < 20; op++)
+        {
+          size_t start = size > 0 ? random_ulong () % (size + 1) : 0;
+          size_t cnt = random_ulong () % 10;
+          bool value = random_ulong () % 4 == 0;
+          size_t expect = slow_scan (b, start, cnt, value);
+
+          if (op % 2 == 0)
+            {
+              ASSERT (bitmap_scan (b, start, cnt, value) == expect);
+            }
+          else
+            {
+              ASSERT (bitmap_scan_and_flip (b, start, cnt, value) == expect);
+              if (size > 0)
+                bitmap_reset (b, random_ulong () % size);
+            }
+        }
+      bitmap_destroy (b);
+      if (iter % 100 == 0)
+        printf (" %d", iter);
+    }
+  printf (" ok\n");
+}
+
+/* Fills a BENCH_BITS bitmap one bit at a time with first-fit
+   allocation, frees every other bit, and allocates single bits
+   again, reporting the average cost of an allocation. */
+static void
+bench (void)
+{
+  struct bitmap *b = bitmap_create (BENCH_BITS);
+  uint64_t start;
+  size_t i;
+
+  ASSERT (b != NULL);
+
+  start = timer_cycles ();
+  for (i = 0; i < BENCH_BITS; i++)
+    ASSERT (bitmap_scan_and_flip (b, 0, 1, false) == i);
+  printf ("fill: %llu cycles per allocation\n",
+          (timer_cycles () - start) / BENCH_BITS);
+
+  for (i = 0; i < BENCH_BITS; i += 2)
+    bitmap_reset (b, i);
+  start = timer_cycles ();
+  for (i = 0; i < BENCH_BITS; i += 2)
+    ASSERT (bitmap_scan_and_flip (b, 0, 1, false) == i);
+  printf ("refill: %llu cycles per allocation\n",
+          (timer_cycles () - start) / (BENCH_BITS / 2));
+
+  ASSERT (bitmap_scan_and_flip (b, 0, 1, false) == BITMAP_ERROR);
+  bitmap_destroy (b);
+}
@@ -0,0 +1,209 @@
+/* Test program for vm/zswap.c.
+
+   Stores pages of several kinds with zswap_store() and checks
+   that every page it accepts comes back unchanged from
+   zswap_load(): same-filled pages, patterned pages whose matches
+   overlap the bytes they copy, random pages, pages whose literal
+   runs straddle MAX_LITERALS, and pages whose compressed size
+   straddles MAX_ZSIZE.
+
+   This is not a test we will run on your submitted tasks.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+#include "threads/vaddr.h"
+#include "vm/zswap.h"
+
+/* Largest compressed page zswap keeps, as in vm/zswap.c. */
+#define MAX_ZSIZE (PGSIZE * 3 / 4)
+
+/* Longest run of literals in one token, as in vm/zswap.c. */
+#define MAX_LITERALS 0x80
+
+/* The page stored, and the page loaded back. */
+static uint8_t page[PGSIZE] __attribute__ ((aligned (4)));
+static uint8_t copy[PGSIZE] __attribute__ ((aligned (4)));
+
+/* Random bytes that do not compress. */
+static uint8_t noise[PGSIZE];
+
+static bool round_trip (size_t *size);
+static void noise_then_zeros (size_t noise_len);
+static void test_same_filled (void);
+static void test_patterned (void);
+static void test_random (void);
+static void test_literal_runs (void);
+static void test_max_zsize (void);
+
+/* Test the compressed swap implementation. */
+void
+test (void)
+{
+  zswap_init ();
+  random_init (0);
+  random_bytes (noise, sizeof noise);
+
+  test_same_filled ();
+  test_patterned ();
+  test_random ();
+  test_literal_runs ();
+  test_max_zsize ();
+  printf ("done\n");
+}
+
+/* Stores PAGE with zswap.  If zswap takes it, checks that it is
+   stored in at most MAX_ZSIZE bytes and loads back unchanged,
+   stores its compressed size in *SIZE if SIZE is non-null, frees
+   it, and returns true.  Otherwise, returns false. */
+static bool
+round_trip (size_t *size)
+{
+  struct zswap_entry e;
+
+  if (!zswap_store (page, &e))
+    return false;
+  ASSERT (e.size <= MAX_ZSIZE);
+
+  memset (copy, 0xcc, sizeof copy);
+  zswap_load (&e, copy);
+  ASSERT (!memcmp (page, copy, PGSIZE));
+
+  if (size != NULL)
+    *size = e.size;
+  zswap_free (&e);
+  return true;
+}
+
+/* Fills PAGE with the first NOISE_LEN bytes of noise[], followed
+   by zeros. */
+static void
+noise_then_zeros (size_t noise_len)
+{
+  memcpy (page, noise, noise_len);
+  memset (page + noise_len, 0, PGSIZE - noise_len);
+}
+
+/* Pages of one repeated word take no space at all. */
+static void
+test_same_filled (void)
+{
+  static const uint32_t fills[] = {0, 0xffffffff, 0xdeadbeef, 0x01000000};
+  size_t i, j;
+
+  printf ("testing same-filled pages\n");
+  for (i = 0; i < sizeof fills / sizeof *fills; i++)
+    {
+      uint32_t *words = (uint32_t *) page;
+      size_t size;
+
+      for (j = 0; j < PGSIZE / sizeof *words; j++)
+        words[j] = fills[i];
+      ASSERT (round_trip (&size));
+      ASSERT (size == 0);
+    }
+}
+
+/* A page of a short repeating pattern compresses to a few
+   literals and then matches whose offset, the pattern's period,
+   is shorter than the match, so that each match copies bytes it
+   has itself just produced.  Changing the first byte keeps
+   periods that divide 4 from making the page same-filled. */
+static void
+test_patterned (void)
+{
+  size_t period, i;
+
+  printf ("testing patterned pages\n");
+  for (period = 1; period <= 2 * MAX_LITERALS; period++)
+    {
+      size_t size;
+
+      for (i = 0; i < PGSIZE; i++)
+        page[i] = noise[i % period];
+      page[0] ^= 0xff;
+      ASSERT (round_trip (&size));
+      ASSERT (size > 0);
+      ASSERT (size < PGSIZE / 4);
+    }
+}
+
+/* Random pages do not compress and must be refused, not stored
+   truncated.  Pages of random bytes drawn from a small alphabet
+   compress to a mix of short matches and literals. */
+static void
+test_random (void)
+{
+  unsigned bits;
+  int i;
+
+  printf ("testing random pages\n");
+  for (i = 0; i < 16; i++)
+    {
+      random_bytes (page, PGSIZE);
+      ASSERT (!round_trip (NULL));
+    }
+
+  for (bits = 1; bits <= 8; bits++)
+    for (i = 0; i < 4; i++)
+      {
+        size_t j;
+
+        random_bytes (page, PGSIZE);
+        for (j = 0; j < PGSIZE; j++)
+          page[j] &= (1u << bits) - 1;
+        round_trip (NULL);
+      }
+}
+
+/* A page of N noise bytes followed by zeros compresses to a run
+   of N + 1 literals, split into tokens of at most MAX_LITERALS,
+   and then matches.  Try every N around the splits. */
+static void
+test_literal_runs (void)
+{
+  size_t noise_len;
+
+  printf ("testing literal runs\n");
+  for (noise_len = 1; noise_len <= 3 * MAX_LITERALS + 1; noise_len++)
+    {
+      size_t size;
+
+      noise_then_zeros (noise_len);
+      ASSERT (round_trip (&size));
+      ASSERT (size >= noise_len + 1 + noise_len / MAX_LITERALS);
+    }
+}
+
+/* Lengthen the noise at the start of a page a byte at a time, so
+   that the compressed size passes MAX_ZSIZE in steps of a byte or
+   two.  Pages just under the limit must be stored, and those
+   over it refused. */
+static void
+test_max_zsize (void)
+{
+  size_t noise_len, max_size = 0;
+  bool refused = false;
+
+  printf ("testing MAX_ZSIZE boundary\n");
+  for (noise_len = 0; noise_len <= PGSIZE; noise_len++)
+    {
+      size_t size;
+
+      noise_then_zeros (noise_len);
+      if (round_trip (&size))
+        {
+          if (size > max_size)
+            max_size = size;
+        }
+      else
+        refused = true;
+    }
+  ASSERT (refused);
+  ASSERT (max_size + 2 >= MAX_ZSIZE);
+}
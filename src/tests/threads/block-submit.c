@@ -0,0 +1,98 @@
+/* Submits several asynchronous requests to a RAM disk, some of
+   them for adjacent sectors that the block layer may merge, and
+   checks that every completion function runs exactly once and
+   that the data read back matches what was written. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "devices/block.h"
+#include "devices/ramdisk.h"
+#include "threads/synch.h"
+
+#define REQ_CNT 16
+#define REQ_SECTORS 2
+
+static struct block_request reqs[REQ_CNT];
+static uint8_t data[REQ_CNT][REQ_SECTORS * BLOCK_SECTOR_SIZE];
+static int done_cnt[REQ_CNT];
+static struct semaphore all_done;
+static int finished;
+
+static block_done_func request_done;
+static void submit_all (struct block *, bool write);
+
+void
+test_block_submit (void)
+{
+  struct block *disk;
+  int i;
+
+  disk = ramdisk_create ("rd-test", BLOCK_RAW, REQ_CNT * REQ_SECTORS);
+  if (disk == NULL)
+    fail ("can't create RAM disk");
+  sema_init (&all_done, 0);
+
+  /* Write a different pattern to each request's sectors. */
+  for (i = 0; i < REQ_CNT; i++)
+    memset (data[i], 'a' + i, sizeof data[i]);
+  submit_all (disk, true);
+  msg ("%d writes completed.", finished);
+
+  /* Read the sectors back, in reverse order. */
+  memset (data, 0, sizeof data);
+  submit_all (disk, false);
+  msg ("%d reads completed.", finished);
+
+  for (i = 0; i < REQ_CNT; i++)
+    {
+      size_t j;
+      for (j = 0; j < sizeof data[i]; j++)
+        if (data[i][j] != 'a' + i)
+          fail ("request %d read back byte %zu as %d", i, j, data[i][j]);
+    }
+  msg ("Data read back matches.");
+}
+
+/* Submits REQ_CNT requests to DISK to write or read data[], and
+   waits for all of them to complete. */
+static void
+submit_all (struct block *disk, bool write)
+{
+  int i;
+
+  finished = 0;
+  memset (done_cnt, 0, sizeof done_cnt);
+  for (i = 0; i < REQ_CNT; i++)
+    {
+      int idx = write ? i : REQ_CNT - 1 - i;
+      struct block_request *r = &reqs[idx];
+
+      r->write = write;
+      r->sector = idx * REQ_SECTORS;
+      r->cnt = REQ_SECTORS;
+      r->buffer = data[idx];
+      r->done = request_done;
+      r->aux = (void *) idx;
+      block_submit (disk, r);
+    }
+  sema_down (&all_done);
+
+  for (i = 0; i < REQ_CNT; i++)
+    if (done_cnt[i] != 1)
+      fail ("request %d completed %d times", i, done_cnt[i]);
+}
+
+/* Completion function: counts the completion of request AUX and
+   wakes the test once all have completed. */
+static void
+request_done (struct block_request *r, void *aux)
+{
+  int idx = (int) aux;
+
+  if (r != &reqs[idx])
+    fail ("completion for request %d got the wrong request", idx);
+  done_cnt[idx]++;
+  if (++finished == REQ_CNT)
+    sema_up (&all_done);
+}
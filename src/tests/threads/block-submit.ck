@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(block-submit) begin
+(block-submit) 16 writes completed.
+(block-submit) 16 reads completed.
+(block-submit) Data read back matches.
+(block-submit) end
+EOF
+pass;
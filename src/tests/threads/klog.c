@@ -0,0 +1,39 @@
+/* Logs messages with klog() from an external interrupt handler,
+   then checks that klog_flush() writes all of them to the
+   console, in order, and that the handler really ran in
+   interrupt context. */
+
+#include <klog.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+
+/* An external interrupt vector that no device uses (IRQ 11). */
+#define LOG_VEC 0x2b
+
+#define INTR_CNT 4
+
+static intr_handler_func log_interrupt;
+static int intr_cnt;
+
+void
+test_klog (void) 
+{
+  int i;
+
+  intr_register_ext (LOG_VEC, log_interrupt, "klog test");
+
+  msg ("Raising %d interrupts.", INTR_CNT);
+  for (i = 0; i < INTR_CNT; i++)
+    asm volatile ("int %0" : : "i" (LOG_VEC));
+  klog_flush ();
+  msg ("Flushed %d messages.", intr_cnt);
+}
+
+/* Logs a message saying whether it runs in interrupt context. */
+static void
+log_interrupt (struct intr_frame *f UNUSED) 
+{
+  klog ("Interrupt %d logged %s interrupt context.",
+        intr_cnt++, intr_context () ? "in" : "outside");
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+# Kernel log lines start with the timer tick they were logged at.
+s/^\[\d+\] // foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(klog) begin
+(klog) Raising 4 interrupts.
+Interrupt 0 logged in interrupt context.
+Interrupt 1 logged in interrupt context.
+Interrupt 2 logged in interrupt context.
+Interrupt 3 logged in interrupt context.
+(klog) Flushed 4 messages.
+(klog) end
+EOF
+pass;
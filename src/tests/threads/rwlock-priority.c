@@ -0,0 +1,42 @@
+/* Tests that the highest-priority writer waiting on a
+   reader-writer lock is the first to acquire it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func rwlock_priority_thread;
+static struct rw_lock rw;
+
+void
+test_rwlock_priority (void) 
+{
+  int i;
+  
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rw_lock_init (&rw);
+  rw_lock_acquire_write (&rw);
+  thread_set_priority (PRI_MIN);
+  for (i = 0; i < 10; i++) 
+    {
+      int priority = PRI_DEFAULT - (i + 7) % 10 - 1;
+      char name[16];
+      snprintf (name, sizeof name, "priority %d", priority);
+      thread_create (name, priority, rwlock_priority_thread, NULL);
+    }
+
+  rw_lock_release_write (&rw);
+  msg ("Back in main thread.");
+}
+
+static void
+rwlock_priority_thread (void *aux UNUSED) 
+{
+  rw_lock_acquire_write (&rw);
+  msg ("Thread %s acquired the lock.", thread_name ());
+  rw_lock_release_write (&rw);
+}
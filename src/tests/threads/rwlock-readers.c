@@ -0,0 +1,64 @@
+/* Checks that several threads can hold a reader-writer lock for
+   reading at the same time, and that a writer waits until all of
+   them have released it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define READER_CNT 5
+
+static thread_func reader_thread;
+static thread_func writer_thread;
+static struct rw_lock rw;
+static struct semaphore go;
+static int readers_inside;
+
+void
+test_rwlock_readers (void) 
+{
+  int i;
+  
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rw_lock_init (&rw);
+  sema_init (&go, 0);
+  thread_set_priority (PRI_MIN);
+  for (i = 0; i < READER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, reader_thread, NULL);
+    }
+  msg ("%d readers hold the lock.", readers_inside);
+
+  thread_create ("writer", PRI_DEFAULT, writer_thread, NULL);
+
+  for (i = 0; i < READER_CNT; i++) 
+    sema_up (&go);
+  msg ("Back in main thread.");
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  rw_lock_acquire_read (&rw);
+  readers_inside++;
+  msg ("Thread %s acquired the lock for reading.", thread_name ());
+  sema_down (&go);
+  readers_inside--;
+  msg ("Thread %s releasing the lock.", thread_name ());
+  rw_lock_release_read (&rw);
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  msg ("Writer waiting.");
+  rw_lock_acquire_write (&rw);
+  msg ("Writer acquired the lock with %d readers inside.", readers_inside);
+  rw_lock_release_write (&rw);
+}
@@ -0,0 +1,50 @@
+/* Checks that a waiting writer holds off readers that arrive
+   after it, and that the readers it held off are admitted as
+   soon as the writer releases the lock. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread;
+static thread_func writer_thread;
+static struct rw_lock rw;
+
+void
+test_rwlock_writer_pref (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rw_lock_init (&rw);
+  rw_lock_acquire_read (&rw);
+  msg ("Main thread acquired the lock for reading.");
+
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread, NULL);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread, NULL);
+
+  msg ("Main thread releasing the lock.");
+  rw_lock_release_read (&rw);
+  msg ("Back in main thread.");
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  msg ("Reader waiting.");
+  rw_lock_acquire_read (&rw);
+  msg ("Reader acquired the lock.");
+  rw_lock_release_read (&rw);
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  msg ("Writer waiting.");
+  rw_lock_acquire_write (&rw);
+  msg ("Writer acquired the lock.");
+  rw_lock_release_write (&rw);
+  msg ("Writer released the lock.");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer-pref) begin
+(rwlock-writer-pref) Main thread acquired the lock for reading.
+(rwlock-writer-pref) Writer waiting.
+(rwlock-writer-pref) Reader waiting.
+(rwlock-writer-pref) Main thread releasing the lock.
+(rwlock-writer-pref) Writer acquired the lock.
+(rwlock-writer-pref) Writer released the lock.
+(rwlock-writer-pref) Reader acquired the lock.
+(rwlock-writer-pref) Back in main thread.
+(rwlock-writer-pref) end
+EOF
+pass;
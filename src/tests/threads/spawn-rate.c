@@ -0,0 +1,51 @@
+/* Measures how quickly the kernel can create short-lived
+   threads.  Each thread has a higher priority than the main
+   thread, so it runs and exits before thread_create() returns,
+   which lets its page be recycled for the next one. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SPAWN_CNT 500
+
+static thread_func spawn_thread;
+static int exited;
+
+void
+test_spawn_rate (void) 
+{
+  int64_t start_ticks;
+  uint64_t start_cycles, cycles;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  start_ticks = timer_ticks ();
+  start_cycles = timer_cycles ();
+  for (i = 0; i < SPAWN_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "spawn %d", i);
+      if (thread_create (name, PRI_DEFAULT + 1, spawn_thread, NULL)
+          == TID_ERROR)
+        fail ("thread_create() failed for thread %d", i);
+    }
+  cycles = timer_cycles () - start_cycles;
+
+  if (exited != SPAWN_CNT)
+    fail ("%d threads exited, expected %d", exited, SPAWN_CNT);
+  msg ("Spawned %d threads in %"PRId64" ticks, %"PRIu64" cycles each.",
+       SPAWN_CNT, timer_elapsed (start_ticks), cycles / SPAWN_CNT);
+  pass ();
+}
+
+static void
+spawn_thread (void *aux UNUSED) 
+{
+  exited++;
+}
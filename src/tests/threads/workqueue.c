@@ -0,0 +1,57 @@
+/* Checks that the work queue runs higher-priority work first,
+   that a pending item cannot be queued twice, that cancelled
+   work does not run, and that workqueue_flush() waits for all
+   queued work to finish. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+#define WORK_CNT 4
+
+static work_func record_work;
+static struct work works[WORK_CNT];
+static int order[WORK_CNT];
+static int run_cnt;
+
+void
+test_workqueue (void) 
+{
+  enum intr_level old_level;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  for (i = 0; i < WORK_CNT; i++)
+    work_init (&works[i], record_work, (void *) i);
+
+  /* Queue everything before any worker gets a chance to run. */
+  old_level = intr_disable ();
+  work_submit (&works[0], WORK_PRI_LOW);
+  work_submit (&works[1], WORK_PRI_NORMAL);
+  work_submit (&works[2], WORK_PRI_HIGH);
+  work_submit (&works[3], WORK_PRI_NORMAL);
+  if (work_submit (&works[1], WORK_PRI_HIGH))
+    fail ("pending work was queued twice");
+  if (!work_cancel (&works[3]))
+    fail ("pending work could not be cancelled");
+  intr_set_level (old_level);
+
+  workqueue_flush ();
+  msg ("%d items ran.", run_cnt);
+  for (i = 0; i < run_cnt; i++)
+    msg ("Work %d ran.", order[i]);
+
+  if (work_cancel (&works[2]))
+    fail ("finished work was cancelled");
+}
+
+static void
+record_work (void *aux) 
+{
+  order[run_cnt++] = (int) aux;
+}
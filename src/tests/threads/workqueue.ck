@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) 3 items ran.
+(workqueue) Work 2 ran.
+(workqueue) Work 1 ran.
+(workqueue) Work 0 ran.
+(workqueue) end
+EOF
+pass;
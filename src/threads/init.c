@@ -2,6 +2,7 @@
 #include <console.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <klog.h>
 #include <limits.h>
 #include <random.h>
 #include <stddef.h>
@@ -22,6 +23,7 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -34,6 +36,8 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/iosched.h"
+#include "devices/ramdisk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -54,6 +58,9 @@ static const char *filesys_bdev_name;
 static const char *scratch_bdev_name;
 #ifdef VM
 static const char *swap_bdev_name;
+
+/* -ramswap: Size of RAM disk to create for swap, in MB. */
+static size_t ramswap_mb;
 #endif
 #endif /* FILESYS */
 
@@ -121,12 +128,26 @@ main (void)
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  workqueue_init ();
+  klog_init ();
   serial_init_queue ();
   timer_calibrate ();
 
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
+#ifdef VM
+  if (ramswap_mb > 0)
+    {
+      if (ramdisk_create ("ram0", BLOCK_SWAP,
+                          ramswap_mb * (1024 * 1024 / BLOCK_SECTOR_SIZE))
+          == NULL)
+        printf ("ram0: can't create %zu MB RAM disk for swap\n",
+                ramswap_mb);
+      else if (swap_bdev_name == NULL)
+        swap_bdev_name = "ram0";
+    }
+#endif
   locate_block_devices ();
   filesys_init (format_filesys);
   swaptable_init ();
@@ -138,7 +159,7 @@ main (void)
   run_actions (argv);
 
   /* Finish up. */
-  shutdown ();
+  shutdown_orderly ();
   thread_exit ();
 }
 
@@ -245,6 +266,8 @@ parse_options (char **argv)
         shutdown_configure (SHUTDOWN_POWER_OFF);
       else if (!strcmp (name, "-r"))
         shutdown_configure (SHUTDOWN_REBOOT);
+      else if (!strcmp (name, "-novga"))
+        console_use_vga = false;
 #ifdef FILESYS
       else if (!strcmp (name, "-f"))
         format_filesys = true;
@@ -252,9 +275,26 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-nodma"))
+        ide_use_dma = false;
+      else if (!strcmp (name, "-iosched"))
+        {
+          if (value == NULL || !iosched_set_default (value))
+            PANIC ("unknown I/O scheduler `%s'", value != NULL ? value : "");
+        }
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
+      else if (!strcmp (name, "-ramswap"))
+        {
+          /* At most 6 digits, so that the size in sectors fits. */
+          if (value == NULL || *value == '\0' || strlen (value) > 6
+              || value[strspn (value, "0123456789")] != '\0'
+              || atoi (value) == 0)
+            PANIC ("-ramswap requires a size in MB from 1 to 999999 "
+                   "(use -h for help)");
+          ramswap_mb = atoi (value);
+        }
 #endif
 #endif
       else if (!strcmp (name, "-rs"))
@@ -264,6 +304,8 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-tracepf"))
+        trace_page_faults = true;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -374,18 +416,25 @@ usage (void)
           "  -h                 Print this help message and power off.\n"
           "  -q                 Power off VM after actions or on panic.\n"
           "  -r                 Reboot after actions.\n"
+          "  -novga             Write console output to serial port only.\n"
 #ifdef FILESYS
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -nodma             Transfer disk sectors by PIO, not DMA.\n"
+          "  -iosched=POLICY    Schedule disk I/O by POLICY: noop, clook,\n"
+          "                     or deadline (the default).\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+          "  -ramswap=MB        Create MB-megabyte RAM disk ram0 and, unless\n"
+          "                     -swap is given, use it for swap.\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -tracepf           Log every page fault to the kernel log.\n"
 #endif
           );
   shutdown_power_off ();
@@ -9,6 +9,7 @@
 #include <string.h>
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "vm/frame.h"
 
@@ -29,7 +30,7 @@
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
+    struct adaptive_lock lock;          /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
   };
@@ -39,6 +40,7 @@ static struct pool kernel_pool, user_pool;
 
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
+static size_t scan_pool (struct pool *, size_t page_cnt);
 static bool page_from_pool (const struct pool *, void *page);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
@@ -78,9 +80,13 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  page_idx = scan_pool (pool, page_cnt);
+
+  /* The thread module keeps pages of exited threads for reuse.
+     If the kernel pool is short, have it give them back. */
+  if (page_idx == BITMAP_ERROR && pool == &kernel_pool
+      && thread_cache_drain () > 0)
+    page_idx = scan_pool (pool, page_cnt);
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -119,6 +125,23 @@ palloc_get_page (enum palloc_flags flags)
   return palloc_get_multiple (flags, 1);
 }
 
+/* Returns the number of free pages in the user pool if PAL_USER
+   is set in FLAGS, otherwise in the kernel pool.  Other threads
+   may allocate or free pages at any time, so the count is only a
+   hint. */
+size_t
+palloc_free_cnt (enum palloc_flags flags)
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  size_t cnt;
+
+  adaptive_lock_acquire (&pool->lock);
+  cnt = bitmap_count (pool->used_map, 0, bitmap_size (pool->used_map),
+                      false);
+  adaptive_lock_release (&pool->lock);
+  return cnt;
+}
+
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) 
@@ -159,6 +182,20 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Finds PAGE_CNT contiguous free pages in POOL and marks them
+   used.  Returns the index of the first, or BITMAP_ERROR if
+   there are not that many. */
+static size_t
+scan_pool (struct pool *pool, size_t page_cnt)
+{
+  size_t page_idx;
+
+  adaptive_lock_acquire (&pool->lock);
+  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  adaptive_lock_release (&pool->lock);
+  return page_idx;
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
@@ -175,7 +212,7 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
+  adaptive_lock_init (&p->lock, ADAPTIVE_SPIN_DEFAULT);
   p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
   p->base = base + bm_pages * PGSIZE;
 }
@@ -33,6 +33,8 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+static void sema_down_on (struct semaphore *, enum wait_reason);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -60,6 +62,14 @@ sema_init (struct semaphore *sema, unsigned value)
    thread will probably turn interrupts back on. */
 void
 sema_down (struct semaphore *sema) 
+{
+  sema_down_on (sema, WAIT_SEMA);
+}
+
+/* Like sema_down(), but records REASON as the cause of any wait
+   in the current thread's scheduling statistics. */
+static void
+sema_down_on (struct semaphore *sema, enum wait_reason reason) 
 {
   enum intr_level old_level;
 
@@ -70,7 +80,7 @@ sema_down (struct semaphore *sema)
   while (sema->value == 0) 
     {
       list_push_back (&sema->waiters, &thread_current ()->elem);
-      thread_block ();
+      thread_block_on (reason);
     }
   sema->value--;
   intr_set_level (old_level);
@@ -225,7 +235,7 @@ lock_acquire (struct lock *lock)
   }
   lock_obtain(lock); 
   intr_set_level (old_level);*/
-  sema_down (&lock->semaphore);
+  sema_down_on (&lock->semaphore, WAIT_LOCK);
   lock->holder = thread_current ();
 }
 
@@ -244,7 +254,8 @@ lock_try_acquire (struct lock *lock)
   ASSERT (!lock_held_by_current_thread (lock));
 
   success = sema_try_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  if (success)
+    lock->holder = thread_current ();
   //if (success)
   //  lock_obtain(lock); 
   return success;
@@ -285,6 +296,388 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
+/* Adaptive lock statistics, summed over all adaptive locks. */
+static unsigned adaptive_acquire_cnt;   /* Number of acquisitions. */
+static unsigned adaptive_contended_cnt; /* Acquisitions that found it held. */
+static unsigned adaptive_spin_cnt;      /* Contended, won by yielding. */
+static unsigned adaptive_block_cnt;     /* Contended, slept. */
+
+/* Initializes adaptive lock LOCK.  A contended acquire will
+   yield the CPU up to SPIN_LIMIT times, retrying the lock after
+   each yield, before it falls back to sleeping on the lock.
+   Yielding lets the holder of a short critical section run to
+   completion and release the lock without the waiter paying for
+   a full block and wake-up. */
+void
+adaptive_lock_init (struct adaptive_lock *lock, unsigned spin_limit)
+{
+  ASSERT (lock != NULL);
+
+  lock_init (&lock->lock);
+  lock->spin_limit = spin_limit;
+}
+
+/* Returns true if yielding the CPU could let HOLDER, which holds
+   a lock the current thread wants, run and release it: HOLDER is
+   ready to run and the scheduler will pick it ahead of the
+   current thread.  A holder that is blocked, or that has lower
+   priority than the current thread, will not run when we yield,
+   so there is no point in spinning on it.  A null HOLDER means
+   the lock may already be free.  Interrupts must be off. */
+static bool
+yield_lets_run (struct thread *holder)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  return (holder == NULL
+          || (holder->status == THREAD_READY
+              && (thread_get_effective_priority (holder)
+                  >= thread_get_priority ())));
+}
+
+/* Acquires LOCK, first yielding a bounded number of times and
+   then sleeping until it becomes available if necessary.  Stops
+   yielding early, and sleeps, as soon as yielding could not let
+   the holder run.  The lock must not already be held by the
+   current thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler.  If interrupts are disabled it does not
+   yield and behaves like lock_acquire(). */
+void
+adaptive_lock_acquire (struct adaptive_lock *lock)
+{
+  unsigned i;
+
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+
+  if (!lock_try_acquire (&lock->lock))
+    {
+      adaptive_contended_cnt++;
+      if (intr_get_level () == INTR_ON)
+        for (i = 0; i < lock->spin_limit; i++)
+          {
+            bool worthwhile;
+
+            intr_disable ();
+            worthwhile = yield_lets_run (lock->lock.holder);
+            intr_enable ();
+            if (!worthwhile)
+              break;
+
+            thread_yield ();
+            if (lock_try_acquire (&lock->lock))
+              {
+                adaptive_spin_cnt++;
+                adaptive_acquire_cnt++;
+                return;
+              }
+          }
+      adaptive_block_cnt++;
+      lock_acquire (&lock->lock);
+    }
+  adaptive_acquire_cnt++;
+}
+
+/* Tries to acquire LOCK without yielding or sleeping and returns
+   true if successful or false on failure. */
+bool
+adaptive_lock_try_acquire (struct adaptive_lock *lock)
+{
+  ASSERT (lock != NULL);
+
+  if (!lock_try_acquire (&lock->lock))
+    return false;
+  adaptive_acquire_cnt++;
+  return true;
+}
+
+/* Releases LOCK, which must be owned by the current thread. */
+void
+adaptive_lock_release (struct adaptive_lock *lock)
+{
+  ASSERT (lock != NULL);
+
+  lock_release (&lock->lock);
+}
+
+/* Returns true if the current thread holds LOCK, false
+   otherwise. */
+bool
+adaptive_lock_held_by_current_thread (const struct adaptive_lock *lock)
+{
+  ASSERT (lock != NULL);
+
+  return lock_held_by_current_thread (&lock->lock);
+}
+
+/* Prints adaptive lock statistics. */
+void
+adaptive_lock_print_stats (void)
+{
+  printf ("Adaptive locks: %u acquires, %u contended, "
+          "%u won by yielding, %u blocked\n",
+          adaptive_acquire_cnt, adaptive_contended_cnt,
+          adaptive_spin_cnt, adaptive_block_cnt);
+}
+
+/* Initializes reader-writer lock RW.  Any number of threads may
+   hold RW for reading at the same time, but a thread holding it
+   for writing excludes all others.
+
+   Writers are preferred: once a writer is waiting, threads that
+   newly try to read wait behind it.  To keep readers from
+   starving in turn, a writer that releases RW admits every
+   reader waiting at that moment before the next writer.  Those
+   readers hold RW from the moment they are woken, so readers
+   arriving later still wait behind the writer.  Within each
+   class, the waiter with the highest effective priority is woken
+   first. */
+void
+rw_lock_init (struct rw_lock *rw)
+{
+  ASSERT (rw != NULL);
+
+  rw->writer = NULL;
+  rw->reader_cnt = 0;
+  rw->writers_waiting = 0;
+  list_init (&rw->read_waiters);
+  list_init (&rw->write_waiters);
+}
+
+/* Returns true if a reader may enter RW now.
+   Interrupts must be off. */
+static bool
+rw_can_read (const struct rw_lock *rw)
+{
+  return rw->writer == NULL && rw->writers_waiting == 0;
+}
+
+/* Returns true if a writer may enter RW now.
+   Interrupts must be off. */
+static bool
+rw_can_write (const struct rw_lock *rw)
+{
+  return rw->writer == NULL && rw->reader_cnt == 0;
+}
+
+/* Wakes the highest-priority writer waiting on RW, if any.
+   Interrupts must be off. */
+static void
+rw_wake_writer (struct rw_lock *rw)
+{
+  struct thread *t;
+
+  if (list_empty (&rw->write_waiters))
+    return;
+  t = list_entry (list_pop_max (&rw->write_waiters, compare_priority, NULL),
+                  struct thread, elem);
+  thread_unblock (t);
+  thread_priority_yield (t);
+}
+
+/* Wakes every reader waiting on RW and lets them in ahead of
+   any waiting writer, counting them as holding RW already, so
+   that no other thread can get in before they run.  Returns
+   true if any reader was woken.  Interrupts must be off. */
+static bool
+rw_wake_readers (struct rw_lock *rw)
+{
+  struct thread *max = NULL;
+
+  if (list_empty (&rw->read_waiters))
+    return false;
+  rw->reader_cnt += list_size (&rw->read_waiters);
+  while (!list_empty (&rw->read_waiters))
+    {
+      struct thread *t = list_entry (list_pop_front (&rw->read_waiters),
+                                     struct thread, elem);
+      if (max == NULL || thread_get_effective_priority (t)
+                         > thread_get_effective_priority (max))
+        max = t;
+      thread_unblock (t);
+    }
+  thread_priority_yield (max);
+  return true;
+}
+
+/* Acquires RW for reading, sleeping until no writer holds it or
+   is waiting for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rw_lock_acquire_read (struct rw_lock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  old_level = intr_disable ();
+  if (rw_can_read (rw))
+    rw->reader_cnt++;
+  else
+    {
+      /* rw_wake_readers() admits us before waking us. */
+      list_push_back (&rw->read_waiters, &thread_current ()->elem);
+      thread_block_on (WAIT_RWLOCK);
+    }
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for reading like rw_lock_acquire_read(), but for
+   very short read-side critical sections: if RW is unavailable,
+   first yields up to SPIN_LIMIT times, retrying after each yield,
+   as adaptive_lock_acquire() does, before sleeping.  Counts
+   towards the adaptive lock statistics. */
+void
+rw_lock_acquire_read_adaptive (struct rw_lock *rw, unsigned spin_limit)
+{
+  unsigned i;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  if (!rw_lock_try_acquire_read (rw))
+    {
+      adaptive_contended_cnt++;
+      if (intr_get_level () == INTR_ON)
+        for (i = 0; i < spin_limit; i++)
+          {
+            bool worthwhile;
+
+            intr_disable ();
+            worthwhile = yield_lets_run (rw->writer);
+            intr_enable ();
+            if (!worthwhile)
+              break;
+
+            thread_yield ();
+            if (rw_lock_try_acquire_read (rw))
+              {
+                adaptive_spin_cnt++;
+                adaptive_acquire_cnt++;
+                return;
+              }
+          }
+      adaptive_block_cnt++;
+      rw_lock_acquire_read (rw);
+    }
+  adaptive_acquire_cnt++;
+}
+
+/* Tries to acquire RW for reading without sleeping.  Returns
+   true if successful, false otherwise. */
+bool
+rw_lock_try_acquire_read (struct rw_lock *rw)
+{
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  success = rw_can_read (rw);
+  if (success)
+    rw->reader_cnt++;
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Releases the current thread's read access to RW.  The last
+   reader out wakes a waiting writer. */
+void
+rw_lock_release_read (struct rw_lock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (rw->reader_cnt > 0);
+  if (--rw->reader_cnt == 0)
+    rw_wake_writer (rw);
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  RW must not already be held by the current thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rw_lock_acquire_write (struct rw_lock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rw_lock_held_by_current_thread (rw));
+
+  old_level = intr_disable ();
+  rw->writers_waiting++;
+  while (!rw_can_write (rw))
+    {
+      list_push_back (&rw->write_waiters, &thread_current ()->elem);
+      thread_block_on (WAIT_RWLOCK);
+    }
+  rw->writers_waiting--;
+  rw->writer = thread_current ();
+  intr_set_level (old_level);
+}
+
+/* Tries to acquire RW for writing without sleeping.  Returns
+   true if successful, false otherwise. */
+bool
+rw_lock_try_acquire_write (struct rw_lock *rw)
+{
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (rw != NULL);
+  ASSERT (!rw_lock_held_by_current_thread (rw));
+
+  old_level = intr_disable ();
+  success = rw_can_write (rw);
+  if (success)
+    rw->writer = thread_current ();
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Releases write access to RW, which must be held by the current
+   thread.  Readers that were waiting are admitted first;
+   otherwise the highest-priority waiting writer is woken. */
+void
+rw_lock_release_write (struct rw_lock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (rw_lock_held_by_current_thread (rw));
+
+  old_level = intr_disable ();
+  rw->writer = NULL;
+  if (!rw_wake_readers (rw))
+    rw_wake_writer (rw);
+  intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rw_lock_held_by_current_thread (const struct rw_lock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -329,7 +722,7 @@ cond_wait (struct condition *cond, struct lock *lock)
   sema_init (&waiter.semaphore, 0);
   list_push_back (&cond->waiters, &waiter.elem);
   lock_release (lock);
-  sema_down (&waiter.semaphore);
+  sema_down_on (&waiter.semaphore, WAIT_COND);
   lock_acquire (lock);
 }
 
@@ -31,6 +31,50 @@ bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Default number of yields an adaptive lock makes before
+   sleeping. */
+#define ADAPTIVE_SPIN_DEFAULT 4
+
+/* Adaptive lock.  A lock for very short critical sections: a
+   contended acquire yields a bounded number of times, retrying
+   after each yield, before it sleeps on the lock. */
+struct adaptive_lock
+  {
+    struct lock lock;           /* Underlying lock. */
+    unsigned spin_limit;        /* Yields to attempt before sleeping. */
+  };
+
+void adaptive_lock_init (struct adaptive_lock *, unsigned spin_limit);
+void adaptive_lock_acquire (struct adaptive_lock *);
+bool adaptive_lock_try_acquire (struct adaptive_lock *);
+void adaptive_lock_release (struct adaptive_lock *);
+bool adaptive_lock_held_by_current_thread (const struct adaptive_lock *);
+void adaptive_lock_print_stats (void);
+
+/* Reader-writer lock.
+   Any number of readers may hold the lock at once, or a single
+   writer.  Waiting writers hold off newly arriving readers, and
+   a releasing writer admits every reader that was waiting, so
+   neither side starves. */
+struct rw_lock
+  {
+    struct thread *writer;      /* Thread holding write access. */
+    unsigned reader_cnt;        /* Number of threads holding read access. */
+    unsigned writers_waiting;   /* Writers waiting for access. */
+    struct list read_waiters;   /* Readers waiting for access. */
+    struct list write_waiters;  /* Writers waiting for access. */
+  };
+
+void rw_lock_init (struct rw_lock *);
+void rw_lock_acquire_read (struct rw_lock *);
+void rw_lock_acquire_read_adaptive (struct rw_lock *, unsigned spin_limit);
+bool rw_lock_try_acquire_read (struct rw_lock *);
+void rw_lock_release_read (struct rw_lock *);
+void rw_lock_acquire_write (struct rw_lock *);
+bool rw_lock_try_acquire_write (struct rw_lock *);
+void rw_lock_release_write (struct rw_lock *);
+bool rw_lock_held_by_current_thread (const struct rw_lock *);
+
 /* Condition variable. */
 struct condition 
   {
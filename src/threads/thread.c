@@ -17,6 +17,9 @@
 #ifdef USERPROG
 #include "userprog/process.h"
 
+#endif
+#ifdef FILESYS
+#include "filesys/directory.h"
 #endif
 
 /* Random value for struct thread's `magic' member.
@@ -38,8 +41,14 @@ static struct thread *idle_thread;
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
-/* Lock used by allocate_tid(). */
-static struct lock tid_lock;
+/* Pages of exited threads, kept for reuse by thread_create() so
+   that spawning a thread need not go through palloc or zero a
+   whole page.  init_thread() reinitializes the struct thread at
+   the bottom of a recycled page; the stack above it is left as
+   is.  Accessed only with interrupts off. */
+#define THREAD_CACHE_MAX 16
+static void *thread_cache[THREAD_CACHE_MAX];
+static size_t thread_cache_cnt;
 
 /* Average number of threads running */
 static fp load_avg;
@@ -60,6 +69,28 @@ static long long user_ticks;    /* # of timer ticks in user programs. */
 /* Scheduling. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
+/* Scheduling latency histogram.  Bucket I counts switches to a
+   thread that had been ready for 2**I to 2**(I+1) - 1 cycles;
+   bucket 0 also counts waits of 0 cycles.  The idle thread is
+   not counted. */
+#define LATENCY_BUCKETS 40
+static unsigned latency_hist[LATENCY_BUCKETS];
+
+/* Sum of the statistics of threads that have exited. */
+static struct thread_stats exited_stats;
+
+/* Per-thread statistics copied out of all_list by
+   thread_print_stats(), so that they can be printed without
+   holding interrupts off. */
+struct stats_snapshot
+  {
+    tid_t tid;
+    char name[16];
+    struct thread_stats stats;
+  };
+#define SNAPSHOT_MAX 32
+static struct stats_snapshot snapshot[SNAPSHOT_MAX];
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-mlfqs". */
@@ -75,15 +106,20 @@ static void init_thread (struct thread *, const char *name, int priority,
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
+static void account_switch (struct thread *cur, struct thread *next);
+static void add_stats (struct thread_stats *, const struct thread_stats *);
+static void print_stats_line (const char *, const struct thread_stats *);
+static void yield (bool preempted);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct thread *alloc_thread_page (void);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the run queue and the list of all threads.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -96,7 +132,6 @@ thread_init (void)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
   list_init (&ready_list);
   list_init (&all_list);
   /* Set up a thread structure for the running thread. */
@@ -104,6 +139,7 @@ thread_init (void)
   init_thread (initial_thread, "main", PRI_DEFAULT, NICE_DEFAULT, 0);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+  initial_thread->stats.run_since = timer_cycles ();
   list_init (&initial_thread->priority_list);
   lock_init (&initial_thread->priority_list_lock);
   list_init (&initial_thread->file_list);
@@ -164,12 +200,86 @@ thread_tick (void)
     intr_yield_on_return ();
 }
 
-/* Prints thread statistics. */
+/* Prints thread statistics: global tick counts, scheduling
+   statistics for each live thread and for all exited threads
+   together, and the scheduling latency histogram. */
 void
 thread_print_stats (void) 
 {
+  struct thread_stats total;
+  struct list_elem *e;
+  enum intr_level old_level;
+  size_t cnt, i;
+  int last;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+
+  /* Copy out everything we print while interrupts are off, since
+     printf() may block on the console lock. */
+  old_level = intr_disable ();
+  total = exited_stats;
+  cnt = 0;
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      add_stats (&total, &t->stats);
+      if (cnt < SNAPSHOT_MAX)
+        {
+          snapshot[cnt].tid = t->tid;
+          strlcpy (snapshot[cnt].name, t->name, sizeof snapshot[cnt].name);
+          snapshot[cnt].stats = t->stats;
+          cnt++;
+        }
+    }
+  intr_set_level (old_level);
+
+  for (i = 0; i < cnt; i++)
+    {
+      char label[32];
+      snprintf (label, sizeof label, "%d (%s)",
+                snapshot[i].tid, snapshot[i].name);
+      print_stats_line (label, &snapshot[i].stats);
+    }
+  print_stats_line ("exited", &exited_stats);
+  print_stats_line ("total", &total);
+
+  for (last = LATENCY_BUCKETS - 1; last > 0; last--)
+    if (latency_hist[last] != 0)
+      break;
+  printf ("Scheduling latency (cycles):\n");
+  for (i = 0; i <= (size_t) last; i++)
+    printf ("  %12llu+: %u\n", i == 0 ? 0ULL : 1ULL << i, latency_hist[i]);
+}
+
+/* Prints one line of scheduling statistics S, labeled LABEL. */
+static void
+print_stats_line (const char *label, const struct thread_stats *s)
+{
+  printf ("Sched %s: %llu run, %llu wait cycles; "
+          "%u voluntary, %u involuntary switches; "
+          "blocked %u other, %u sema, %u lock, %u cond, %u rwlock, "
+          "%u intq\n",
+          label, s->run_cycles, s->wait_cycles,
+          s->voluntary_cnt, s->involuntary_cnt,
+          s->block_cnt[WAIT_OTHER], s->block_cnt[WAIT_SEMA],
+          s->block_cnt[WAIT_LOCK], s->block_cnt[WAIT_COND],
+          s->block_cnt[WAIT_RWLOCK], s->block_cnt[WAIT_INTQ]);
+}
+
+/* Adds the counters in B into A. */
+static void
+add_stats (struct thread_stats *a, const struct thread_stats *b)
+{
+  int i;
+
+  a->wait_cycles += b->wait_cycles;
+  a->run_cycles += b->run_cycles;
+  a->voluntary_cnt += b->voluntary_cnt;
+  a->involuntary_cnt += b->involuntary_cnt;
+  for (i = 0; i < WAIT_REASON_CNT; i++)
+    a->block_cnt[i] += b->block_cnt[i];
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -201,7 +311,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = alloc_thread_page ();
   if (t == NULL)
     return TID_ERROR;
 
@@ -240,6 +350,11 @@ thread_create (const char *name, int priority,
   t->fd_incr = 2;
   list_init (&t->mappings);
   t->mapid_incr = 0;
+#ifdef FILESYS
+  /* A new thread starts in its creator's working directory. */
+  if (thread_current ()->cwd != NULL)
+    t->cwd = dir_reopen (thread_current ()->cwd);
+#endif
   if (!(t->table = threadtable_init())) 
     return TID_ERROR;
   if (!(t->page_table = pagetable_init()))
@@ -267,10 +382,23 @@ thread_create (const char *name, int priority,
 void
 thread_block (void) 
 {
+  thread_block_on (WAIT_OTHER);
+}
+
+/* Like thread_block(), but records REASON as the cause of the
+   wait in the thread's statistics. */
+void
+thread_block_on (enum wait_reason reason) 
+{
+  struct thread *cur = thread_current ();
+
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (reason < WAIT_REASON_CNT);
 
-  thread_current ()->status = THREAD_BLOCKED;
+  cur->stats.voluntary_cnt++;
+  cur->stats.block_cnt[reason]++;
+  cur->status = THREAD_BLOCKED;
   schedule ();
 }
 
@@ -293,6 +421,7 @@ thread_unblock (struct thread *t)
   ASSERT (t->status == THREAD_BLOCKED);
   list_push_back (&ready_list, &t->elem);
   t->status = THREAD_READY;
+  t->stats.ready_since = timer_cycles ();
   intr_set_level (old_level);
 }
 
@@ -304,7 +433,7 @@ thread_priority_yield (struct thread *t)
     if (intr_context ())
       intr_yield_on_return ();
     else
-      thread_yield ();
+      thread_preempt ();
   }
 }
 
@@ -364,6 +493,23 @@ thread_exit (void)
    may be scheduled again immediately at the scheduler's whim. */
 void
 thread_yield (void) 
+{
+  yield (false);
+}
+
+/* Like thread_yield(), but for a thread that is being forced off
+   the CPU by the end of its time slice or by a higher-priority
+   thread, which is counted as an involuntary switch. */
+void
+thread_preempt (void) 
+{
+  yield (true);
+}
+
+/* Puts the running thread back on the ready list and schedules,
+   counting the switch as involuntary if PREEMPTED. */
+static void
+yield (bool preempted) 
 {
   struct thread *cur = thread_current ();
   enum intr_level old_level;
@@ -371,9 +517,14 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+  if (preempted)
+    cur->stats.involuntary_cnt++;
+  else
+    cur->stats.voluntary_cnt++;
   if (cur != idle_thread) 
     list_push_back (&ready_list, &cur->elem);
   cur->status = THREAD_READY;
+  cur->stats.ready_since = timer_cycles ();
   schedule ();
   intr_set_level (old_level);
 }
@@ -745,7 +896,10 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      if (thread_cache_cnt < THREAD_CACHE_MAX)
+        thread_cache[thread_cache_cnt++] = prev;
+      else
+        palloc_free_page (prev);
     }
 }
 
@@ -767,24 +921,93 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  account_switch (cur, next);
   if (cur != next)
     prev = switch_threads (cur, next);
   thread_schedule_tail (prev);
 }
 
-/* Returns a tid to use for a new thread. */
+/* Charges the running thread CUR for the time since it was
+   scheduled, and charges NEXT, which is about to run, for the
+   time it spent on the ready list.  If CUR is exiting, folds its
+   statistics, including its final time slice, into the totals
+   for exited threads.  Interrupts must be off. */
+static void
+account_switch (struct thread *cur, struct thread *next)
+{
+  uint64_t now = timer_cycles ();
+
+  cur->stats.run_cycles += now - cur->stats.run_since;
+  if (cur->status == THREAD_DYING)
+    add_stats (&exited_stats, &cur->stats);
+  if (next != idle_thread && next->status == THREAD_READY)
+    {
+      uint64_t wait = now - next->stats.ready_since;
+      int bucket = 0;
+
+      next->stats.wait_cycles += wait;
+      while (bucket < LATENCY_BUCKETS - 1 && (wait >> (bucket + 1)) != 0)
+        bucket++;
+      latency_hist[bucket]++;
+    }
+  next->stats.run_since = now;
+}
+
+/* Returns a tid to use for a new thread.  Disabling interrupts
+   around the increment is cheaper than taking a lock. */
 static tid_t
 allocate_tid (void) 
 {
   static tid_t next_tid = 1;
+  enum intr_level old_level;
   tid_t tid;
 
-  lock_acquire (&tid_lock);
+  old_level = intr_disable ();
   tid = next_tid++;
-  lock_release (&tid_lock);
+  intr_set_level (old_level);
 
   return tid;
 }
+
+/* Frees every page in the cache of pages of exited threads, for
+   use when memory runs short.  Returns the number of pages
+   freed. */
+size_t
+thread_cache_drain (void)
+{
+  void *pages[THREAD_CACHE_MAX];
+  enum intr_level old_level;
+  size_t cnt, i;
+
+  old_level = intr_disable ();
+  cnt = thread_cache_cnt;
+  memcpy (pages, thread_cache, cnt * sizeof *pages);
+  thread_cache_cnt = 0;
+  intr_set_level (old_level);
+
+  for (i = 0; i < cnt; i++)
+    palloc_free_page (pages[i]);
+  return cnt;
+}
+
+/* Returns a page for a new thread, taken from the cache of pages
+   of exited threads if possible, otherwise freshly allocated.
+   Returns a null pointer if no page is available. */
+static struct thread *
+alloc_thread_page (void) 
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (thread_cache_cnt > 0)
+    t = thread_cache[--thread_cache_cnt];
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    t = palloc_get_page (PAL_ZERO);
+  return t;
+}
 
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
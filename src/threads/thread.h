@@ -34,6 +34,31 @@ typedef int tid_t;
 
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 
+/* Why a thread blocked, for scheduling statistics. */
+enum wait_reason
+  {
+    WAIT_OTHER,         /* Direct caller of thread_block(). */
+    WAIT_SEMA,          /* sema_down(). */
+    WAIT_LOCK,          /* lock_acquire(). */
+    WAIT_COND,          /* cond_wait(). */
+    WAIT_RWLOCK,        /* Reader-writer lock. */
+    WAIT_INTQ,          /* Interrupt queue. */
+    WAIT_REASON_CNT     /* Number of reasons. */
+  };
+
+/* Scheduling statistics kept for each thread.  Times are in CPU
+   cycles as returned by timer_cycles(). */
+struct thread_stats
+  {
+    uint64_t ready_since;               /* When last made ready. */
+    uint64_t run_since;                 /* When last scheduled. */
+    uint64_t wait_cycles;               /* Total time ready but not running. */
+    uint64_t run_cycles;                /* Total time running. */
+    unsigned voluntary_cnt;             /* Switches by blocking or yielding. */
+    unsigned involuntary_cnt;           /* Switches by preemption. */
+    unsigned block_cnt[WAIT_REASON_CNT]; /* Blocks, by reason. */
+  };
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -110,6 +135,9 @@ struct thread
     struct thread *donated_to;          /* The thread this thread has donated to. */
     struct lock priority_list_lock;
 
+    /* Owned by thread.c. */
+    struct thread_stats stats;          /* Scheduling statistics. */
+
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
@@ -121,6 +149,7 @@ struct thread
     struct list file_list;              /* List of open files. */
     int fd_incr;                        /* File descriptor incrementer. */
     struct file *file;                  /* File kept open. */
+    struct dir *cwd;                    /* Working directory, null for root. */
     struct page_table *page_table;
 
     struct list mappings;               /* List of file to VM mappings. */
@@ -144,11 +173,13 @@ size_t threads_ready(void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+size_t thread_cache_drain (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
 void thread_block (void);
+void thread_block_on (enum wait_reason);
 void thread_unblock (struct thread *);
 void thread_priority_yield (struct thread *);
 
@@ -158,6 +189,7 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -19,18 +19,18 @@ thread_less (const struct hash_elem *a,
        < hash_entry (b, struct threadtable_elem, elem)->tid;
 }
 
-/* Acquire thread table lock. */
+/* Acquire thread table lock for lookups with find(). */
 void 
 threadtable_acquire (struct threadtable *table)
 {
-  lock_acquire (&table->lock);
+  rw_lock_acquire_read (&table->lock);
 }
 
-/* Release thread table lock. */
+/* Release thread table lock taken by threadtable_acquire(). */
 void
 threadtable_release (struct threadtable *table)
 {
-  lock_release (&table->lock);
+  rw_lock_release_read (&table->lock);
 }
 
 /* Initialise thread table. */
@@ -41,7 +41,7 @@ threadtable_init (void)
   if (!table)
     return NULL;
   hash_init (&table->table, thread_hash, thread_less, NULL); 
-  lock_init (&table->lock);
+  rw_lock_init (&table->lock);
   table->refs = 1;
   return table;
 }
@@ -58,7 +58,7 @@ void
 threadtable_destroy (struct threadtable *table)
 {
   hash_destroy (&table->table, threadtable_elem_destroy);
-  lock_release (&table->lock);
+  rw_lock_release_write (&table->lock);
   free (table);
 }
 
@@ -79,9 +79,9 @@ find (struct threadtable *table, int tid)
 bool
 isChild (struct threadtable *table, int parent_tid, int child_tid)
 {
-  lock_acquire (&table->lock);
+  rw_lock_acquire_read (&table->lock);
   struct threadtable_elem *e = find (table, child_tid);
-  lock_release (&table->lock);
+  rw_lock_release_read (&table->lock);
   return e != NULL && e->parent_tid == parent_tid;
 }
 
@@ -90,16 +90,16 @@ isChild (struct threadtable *table, int parent_tid, int child_tid)
 struct threadtable_elem*
 addThread (struct threadtable *table, int parent_tid, int child_tid)
 {
-  lock_acquire (&table->lock);
+  rw_lock_acquire_write (&table->lock);
   if (find (table, child_tid))
   {
-    lock_release (&table->lock);
+    rw_lock_release_write (&table->lock);
     return NULL; 
   }
   struct threadtable_elem *elem = malloc (sizeof(struct threadtable_elem));
   if (!elem)
   {
-    lock_release (&table->lock);
+    rw_lock_release_write (&table->lock);
     return NULL;
   }
   sema_init (&elem->sema, 0);
@@ -111,7 +111,7 @@ addThread (struct threadtable *table, int parent_tid, int child_tid)
   elem->started = false;
   hash_insert (&table->table, &elem->elem);
   table->refs++;
-  lock_release (&table->lock); 
+  rw_lock_release_write (&table->lock); 
   return elem;
 }
 
@@ -145,15 +145,15 @@ decrTableRefs (struct threadtable *table)
 bool
 parentExit (struct threadtable *table, int child_tid)
 {
-  lock_acquire (&table->lock);
+  rw_lock_acquire_write (&table->lock);
   struct threadtable_elem *e = find (table, child_tid);
   if (!e)
   {
-    lock_release (&table->lock);
+    rw_lock_release_write (&table->lock);
     return false;
   }
   decrRefs (table, e); 
-  lock_release (&table->lock); 
+  rw_lock_release_write (&table->lock); 
   return true;
 }
 
@@ -163,17 +163,17 @@ parentExit (struct threadtable *table, int child_tid)
 bool
 childExit (struct threadtable *table, int tid, int status)
 {
-  lock_acquire (&table->lock);
+  rw_lock_acquire_write (&table->lock);
   struct threadtable_elem *e = find (table, tid);
   if (!e)
   {
-    lock_release (&table->lock);
+    rw_lock_release_write (&table->lock);
     return false;
   }
   e->status = status;
   sema_up (&e->sema);
   decrRefs (table, e); 
   if (decrTableRefs (table))
-    lock_release (&table->lock); 
+    rw_lock_release_write (&table->lock); 
   return true;
 }
@@ -20,7 +20,7 @@ struct threadtable_elem {
 
 struct threadtable {
   struct hash table;        /* Stores elems in a hashtable for fast lookup */
-  struct lock lock;         /* Synchronises access to threadtable */
+  struct rw_lock lock;      /* Synchronises access to threadtable */
   int refs;
 };
 
@@ -0,0 +1,219 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* A fixed pool of kernel threads that run deferred work.
+
+   Work may be submitted or cancelled from any context, including
+   interrupt handlers: the queues are protected by disabling
+   interrupts, and waking a worker is a sema_up(), which defers
+   any resulting preemption to intr_yield_on_return() when called
+   from an interrupt. */
+
+/* Number of worker threads. */
+#define WORKER_CNT 2
+
+/* Queued work, one list per priority.  Protected by disabling
+   interrupts. */
+static struct list queues[WORK_PRI_CNT];
+
+/* Counts queued work; workers sleep on it. */
+static struct semaphore work_avail;
+
+/* Number of items queued or running.  When this drops to zero,
+   every thread waiting in workqueue_flush() is woken.  Protected
+   by disabling interrupts. */
+static unsigned busy_cnt;
+static unsigned flush_waiters;
+static struct semaphore flush_done;
+
+/* Statistics. */
+static long long submit_cnt;    /* # of items submitted. */
+static long long run_cnt;       /* # of items run. */
+static long long cancel_cnt;    /* # of items cancelled. */
+
+static thread_func worker;
+static void work_finished (void);
+
+/* Initializes the work queue and starts its worker threads.
+   Must be called after thread_start(). */
+void
+workqueue_init (void)
+{
+  int i;
+
+  for (i = 0; i < WORK_PRI_CNT; i++)
+    list_init (&queues[i]);
+  sema_init (&work_avail, 0);
+  sema_init (&flush_done, 0);
+
+  for (i = 0; i < WORKER_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "worker %d", i);
+      if (thread_create (name, PRI_DEFAULT, worker, NULL) == TID_ERROR)
+        PANIC ("workqueue_init: can't create %s", name);
+    }
+}
+
+/* Initializes WORK to call FUNC with AUX when run. */
+void
+work_init (struct work *work, work_func *func, void *aux)
+{
+  ASSERT (work != NULL);
+  ASSERT (func != NULL);
+
+  work->func = func;
+  work->aux = aux;
+  work->pending = false;
+}
+
+/* Queues WORK to be run by a worker thread at priority PRI.
+   Returns false, without queuing it again, if WORK is already
+   pending.
+
+   This function may be called from an interrupt handler. */
+bool
+work_submit (struct work *work, enum work_priority pri)
+{
+  enum intr_level old_level;
+  bool queued;
+
+  ASSERT (work != NULL);
+  ASSERT (pri < WORK_PRI_CNT);
+
+  old_level = intr_disable ();
+  queued = !work->pending;
+  if (queued)
+    {
+      work->pending = true;
+      list_push_back (&queues[pri], &work->elem);
+      busy_cnt++;
+      submit_cnt++;
+      sema_up (&work_avail);
+    }
+  intr_set_level (old_level);
+
+  return queued;
+}
+
+/* Removes WORK from the queue if it has not started running.
+   Returns true if it was removed, false if it was not pending.
+   Work that is already running is not waited for; use
+   workqueue_flush() for that.
+
+   This function may be called from an interrupt handler. */
+bool
+work_cancel (struct work *work)
+{
+  enum intr_level old_level;
+  bool cancelled;
+
+  ASSERT (work != NULL);
+
+  old_level = intr_disable ();
+  cancelled = work->pending;
+  if (cancelled)
+    {
+      /* Take back the wakeup WORK was given.  If a worker has
+         already consumed it, that worker will find the queue
+         short and go back to sleep. */
+      work->pending = false;
+      list_remove (&work->elem);
+      sema_try_down (&work_avail);
+      cancel_cnt++;
+      work_finished ();
+    }
+  intr_set_level (old_level);
+
+  return cancelled;
+}
+
+/* Returns true if WORK is queued but has not started running. */
+bool
+work_pending (const struct work *work)
+{
+  return work->pending;
+}
+
+/* Waits until every work item queued or running when it is
+   called, and any submitted meanwhile, has finished. */
+void
+workqueue_flush (void)
+{
+  enum intr_level old_level;
+
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  if (busy_cnt > 0)
+    {
+      flush_waiters++;
+      sema_down (&flush_done);
+    }
+  intr_set_level (old_level);
+}
+
+/* Prints work queue statistics. */
+void
+workqueue_print_stats (void)
+{
+  printf ("Workqueue: %lld submitted, %lld run, %lld cancelled\n",
+          submit_cnt, run_cnt, cancel_cnt);
+}
+
+/* Worker thread.  Repeatedly runs the oldest item of the highest
+   priority that has work queued. */
+static void
+worker (void *aux UNUSED)
+{
+  for (;;)
+    {
+      enum intr_level old_level;
+      struct work *work = NULL;
+      int pri;
+
+      sema_down (&work_avail);
+
+      old_level = intr_disable ();
+      for (pri = WORK_PRI_CNT - 1; pri >= 0; pri--)
+        if (!list_empty (&queues[pri]))
+          {
+            work = list_entry (list_pop_front (&queues[pri]),
+                               struct work, elem);
+            work->pending = false;
+            break;
+          }
+      intr_set_level (old_level);
+
+      /* A cancel can race with us between the sema_down() and
+         taking the item, leaving nothing to run. */
+      if (work == NULL)
+        continue;
+
+      /* WORK may be freed or resubmitted by FUNC, so don't touch
+         it after the call. */
+      work->func (work->aux);
+
+      old_level = intr_disable ();
+      run_cnt++;
+      work_finished ();
+      intr_set_level (old_level);
+    }
+}
+
+/* Accounts for one queued item having run or been cancelled,
+   waking flushers if nothing is left.  Interrupts must be off. */
+static void
+work_finished (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (busy_cnt > 0);
+
+  if (--busy_cnt == 0)
+    for (; flush_waiters > 0; flush_waiters--)
+      sema_up (&flush_done);
+}
@@ -0,0 +1,38 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/* Work priorities.  Workers always run the oldest item of the
+   highest priority that has work queued. */
+enum work_priority
+  {
+    WORK_PRI_LOW,               /* Background cleanup. */
+    WORK_PRI_NORMAL,            /* Write-back and the like. */
+    WORK_PRI_HIGH,              /* Work a thread may soon wait on. */
+    WORK_PRI_CNT                /* Number of priorities. */
+  };
+
+/* Performs deferred work, given auxiliary data AUX. */
+typedef void work_func (void *aux);
+
+/* A unit of deferred work.  The submitter owns the memory, which
+   must stay valid until the work has run or been cancelled. */
+struct work
+  {
+    struct list_elem elem;      /* Element in a queue list. */
+    work_func *func;            /* Function to run. */
+    void *aux;                  /* Argument to FUNC. */
+    bool pending;               /* True while queued. */
+  };
+
+void workqueue_init (void);
+void work_init (struct work *, work_func *, void *aux);
+bool work_submit (struct work *, enum work_priority);
+bool work_cancel (struct work *);
+bool work_pending (const struct work *);
+void workqueue_flush (void);
+void workqueue_print_stats (void);
+
+#endif /* threads/workqueue.h */
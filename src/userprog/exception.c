@@ -1,5 +1,6 @@
 #include "userprog/exception.h"
 #include <inttypes.h>
+#include <klog.h>
 #include <stdio.h>
 #include <string.h>
 #include "userprog/gdt.h"
@@ -17,11 +18,14 @@
 #include "threads/palloc.h"
 #include "filesys/file.h"
 
-extern struct lock filesystem_lock;
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+/* If true, every page fault is logged to the kernel log.
+   Controlled by kernel command-line option "-tracepf". */
+bool trace_page_faults;
+
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
@@ -159,6 +163,13 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+  if (trace_page_faults)
+    klog ("Page fault at %p: %s error %s page in %s context, eip=%p.",
+          fault_addr,
+          not_present ? "not present" : "rights violation",
+          write ? "writing" : "reading",
+          user ? "user" : "kernel", f->eip);
+
    if (user) {
       thread_current ()->esp = f->esp;
    }
@@ -219,15 +230,8 @@ page_fault (struct intr_frame *f)
       {
         //Load from file
         struct file_data *fdata = (struct file_data *) page->data;
-        bool pre_owned = filesystem_lock.holder == thread_current ();
-        if (!pre_owned) {
-          lock_acquire (&filesystem_lock);
-        }
-        file_seek (fdata->file, fdata->ofs);
-        int bytes_read = file_read (fdata->file, frame->kPage, fdata->read_bytes);
-        if (!pre_owned) {
-          lock_release (&filesystem_lock);
-        }
+        int bytes_read = file_read_at (fdata->file, frame->kPage,
+                                       fdata->read_bytes, fdata->ofs);
         if (bytes_read != fdata->read_bytes)
           PANIC ("FAILED TO READ SEGMENT!");
         memset (frame->kPage + fdata->read_bytes, 0, fdata->zero_bytes);
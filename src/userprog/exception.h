@@ -9,6 +9,8 @@
 #define PF_U 0x4    /* 0: kernel, 1: user process. */
 
 #define MAX_STACK_SIZE 4194304  /* 8MB in bytes, which is the maximum size of the stack. */
+extern bool trace_page_faults;
+
 void exception_init (void);
 void exception_print_stats (void);
 
@@ -23,7 +23,6 @@
 #include "vm/page.h"
 #include "vm/frame.h"
 
-extern struct lock filesystem_lock;
 
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
@@ -61,19 +60,13 @@ process_execute (const char *file_name)
 
   exe = strtok_r (temp, " ", &save_ptr);
   
-  lock_acquire (&filesystem_lock);
   struct file *file = filesys_open (exe);
-  lock_release (&filesystem_lock);
 
   if (file == NULL){
     return -1;
   }
 
-  lock_acquire (&filesystem_lock);
-  
   file_close (file);
-  
-  lock_release (&filesystem_lock);
 
   /* Create a new thread to execute FILE_NAME. */
   tid = thread_create (exe, PRI_DEFAULT, start_process, fn_copy);
@@ -178,18 +171,19 @@ process_exit (void)
     parentExit (cur->table, t->tid);
     e = next;
   }
-  lock_acquire (&filesystem_lock);
   file_close (cur->file);
+  dir_close (cur->cwd);
+  cur->cwd = NULL;
   e = list_begin (&cur->file_list);
   while (e != list_end (&cur->file_list))
   {
     struct list_elem *next = list_next (e);
     struct fd_map *current_fd_map = list_entry (e, struct fd_map, elem);
     file_close (current_fd_map->fp);
+    dir_close (current_fd_map->dir);
     free (current_fd_map);
     e = next;
   }
-  lock_release (&filesystem_lock);
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pagetable_destroy (cur->page_table);
@@ -322,9 +316,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
   exe = strtok_r(temp, " ", &save_ptr);
 
-  lock_acquire (&filesystem_lock);
   t->file = filesys_open (exe);
-  lock_release (&filesystem_lock);
   free(temp);
 
   if (t->file == NULL) 
@@ -333,7 +325,6 @@ load (const char *file_name, void (**eip) (void), void **esp)
       goto done; 
     }
 
-  lock_acquire (&filesystem_lock);
   file_deny_write (t->file);
   /* Read and verify executable header. */
   if (file_read (t->file, &ehdr, sizeof ehdr) != sizeof ehdr
@@ -426,7 +417,6 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
  done:
   /* We arrive here whether the load is successful or not. */
-  lock_release (&filesystem_lock);
   return success;
 }
 
@@ -5,24 +5,30 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "devices/block.h"
 #include "devices/shutdown.h"
 #include "devices/input.h"
 #include "userprog/process.h"
+#include "filesys/directory.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
+#include "filesys/inode.h"
 #include "threads/threadtable.h"
 #include "threads/malloc.h"
+#include "vm/frame.h"
 #include "vm/mmap.h"
 #include <string.h>
 
 typedef int pid_t; 
 typedef int mapid_t;
 
-/* File system lock */
-struct lock filesystem_lock;
+/* Longest path, including the null terminator, that a system
+   call accepts. */
+#define PATH_MAX 256
 
 static void syscall_handler (struct intr_frame *);
 struct file *get_corresponding_file (int fd);
+static struct fd_map *get_fd_map (int fd);
 static void halt(void);
 void exit(int status);
 static pid_t exec(const char *file);
@@ -36,6 +42,18 @@ static int write (int fd, const void *buffer, unsigned length);
 static void seek (int fd, unsigned position);
 static unsigned tell (int fd);
 static void close (int fd);
+static unsigned pin_chunk (const void *buffer, unsigned length);
+static size_t buffer_page_cnt (const void *buffer, size_t size);
+static void pin_user_buffer (const void *buffer, size_t size, bool writable);
+static void unpin_user_buffer (const void *buffer, size_t size);
+static int file_transfer (struct file *, void *buffer, unsigned length,
+                          bool reading);
+static bool chdir (const char *dir);
+static bool mkdir (const char *dir);
+static bool readdir (int fd, char *name);
+static bool isdir (int fd);
+static int inumber (int fd);
+static bool iostat (int idx, struct iostat *stats);
 
 static mapid_t mmap (int fd, void *addr);
 static void munmap (mapid_t mapid_t);
@@ -96,20 +114,20 @@ get_int (const uint8_t *uaddr)
   return result;
 }
 
-/* Checks if file_name is valid. */
+/* Checks if file_name is valid, that is, a readable string
+   shorter than PATH_MAX. */
 static bool
 filename_valid (const char *file)
 {
   if (!file) {
     exit (-1);
   }
-  char buffer[15];
   bool valid = false;
-  for (int i = 0; i < 15; ++i) {
-    buffer[i] = get_user ((const uint8_t *) file + i);
-    if (buffer[i] == -1)
+  for (int i = 0; i < PATH_MAX; ++i) {
+    int c = get_user ((const uint8_t *) file + i);
+    if (c == -1)
       exit (-1);
-    else if (buffer[i] == 0)
+    else if (c == 0)
     {
       valid = true;
       break; 
@@ -121,6 +139,15 @@ filename_valid (const char *file)
 // This should return a pointer to the file, from its file descriptor.
 struct file *
 get_corresponding_file (int fd) 
+{
+  struct fd_map *fd_map = get_fd_map (fd);
+
+  return fd_map != NULL ? fd_map->fp : NULL; 
+}
+
+/* Returns the mapping for file descriptor fd, or NULL. */
+static struct fd_map *
+get_fd_map (int fd) 
 {
   struct list *files = &thread_current ()->file_list;
 
@@ -129,7 +156,7 @@ get_corresponding_file (int fd)
   for (e = list_begin (files); e != list_end (files); e = list_next (e)){
     struct fd_map *current_fd_map = list_entry (e, struct fd_map, elem);
     if (current_fd_map->fd == fd){
-      return current_fd_map->fp;
+      return current_fd_map;
     }
   }
 
@@ -140,6 +167,7 @@ get_corresponding_file (int fd)
 static void 
 halt (void)
 {
+  shutdown_flush ();
   shutdown_power_off ();
 }
 
@@ -182,26 +210,18 @@ create (const char *file, unsigned initial_size)
   if (!filename_valid (file))
     return false;
   
-  lock_acquire (&filesystem_lock);
-  
   int32_t file_size = (int32_t) initial_size;
-  bool success = filesys_create (file, file_size);
-  
-  lock_release (&filesystem_lock);
-  return success;
+  return filesys_create (file, file_size);
 }
 
 /* Deletes the file called file. Returns true if successful, false otherwise. */
 static bool 
 remove (const char *file)
 {
-  lock_acquire (&filesystem_lock);
-  
-  bool success = filesys_remove (file);
-  
-  lock_release (&filesystem_lock);
-  
-  return success;
+  if (!filename_valid (file))
+    return false;
+
+  return filesys_remove (file);
 }
 
 /* Opens the file called file. Returns a nonnegative integer handle fd,
@@ -212,25 +232,30 @@ open (const char *file)
   if (!filename_valid (file))
     exit (-1);
   
-  lock_acquire (&filesystem_lock);
-  
   struct file *fp = filesys_open (file);
 
-  if (fp == NULL){ 
-    lock_release (&filesystem_lock);
+  if (fp == NULL)
     return -1;
-  }
   
   int current_ticks = thread_current ()->fd_incr++;
-  lock_release(&filesystem_lock);
 
-  struct fd_map *fd_map = malloc (sizeof (fd_map));
+  struct fd_map *fd_map = malloc (sizeof *fd_map);
   if (!fd_map)
     exit (-1);
 
   fd_map->fp = fp;
   fd_map->fd = current_ticks;
 
+  /* Directories also get a struct dir, which keeps the position
+     for readdir(). */
+  fd_map->dir = NULL;
+  if (inode_is_dir (file_get_inode (fp)))
+  {
+    fd_map->dir = dir_open (inode_reopen (file_get_inode (fp)));
+    if (!fd_map->dir)
+      exit (-1);
+  }
+
   list_push_back(&thread_current ()->file_list, &fd_map->elem);
 
   return fd_map->fd;
@@ -240,20 +265,12 @@ open (const char *file)
 static int 
 filesize (int fd)
 {
-  lock_acquire (&filesystem_lock);
-  
   struct file *file_ptr = get_corresponding_file (fd);
   
-  if (!file_ptr) {
-    lock_release (&filesystem_lock);
+  if (!file_ptr)
     return -1;
-  }
 
-  int length = file_length (file_ptr);
-  
-  lock_release (&filesystem_lock);
-  
-  return length;
+  return file_length (file_ptr);
 }
 
 /* reads size bytes from the file open as fd into buffer
@@ -264,43 +281,19 @@ read (int fd, void *buffer, unsigned length)
   if (!length) {
     return 0;
   }
-
-  int bytesRead = 0;
-  char *buff = malloc (length);
-  if (!buff)
-    exit (-1);
   if (fd == STDIN_FILENO) {
     for (uint32_t i = 0; i < length; ++i) {
-      buff[i] = input_getc (); 
-      bytesRead++; 
+      if (!put_user ((uint8_t *) buffer + i, input_getc ()))
+        exit (-1);
     }
+    return length;
   }
-  else
-  { 
-    lock_acquire (&filesystem_lock);
-    
-    struct file *file_ptr = get_corresponding_file (fd);
-    if (!file_ptr) {
-      lock_release (&filesystem_lock);
-      free (buff);
-      return -1;
-    }
 
-    bytesRead = file_read (file_ptr, buff, length);
-    
-    lock_release (&filesystem_lock);
-  }
-  for (int i = 0; i < bytesRead; ++i)
-  {
-    if (!put_user (buffer + i, buff[i]))
-    {
-      free (buff);
-      exit (-1);
-    }
-  }
-  free (buff);
-  
-  return bytesRead; 
+  struct file *file_ptr = get_corresponding_file (fd);
+  if (!file_ptr || isdir (fd))
+    return -1;
+
+  return file_transfer (file_ptr, buffer, length, true);
 }
 
 /* Writes to the given fd, breaks up the buffer if the fd is the console.
@@ -313,59 +306,131 @@ write (int fd, const void *buffer, unsigned length)
     exit (-1);
   if (!length)
     return 0;
-  char *buff = malloc (sizeof (char) * length);
-  if (!buff)
-    exit (-1);
-  if (is_user_vaddr (buffer))
-  {
-    for (unsigned int i = 0; i < length; ++i)
-    {
-      int result = get_user (buffer + i);
-      if (result == -1)
-      {
-        free (buff);
-        exit (-1);
-      }
-      buff[i] = result;
-    }
-  }
-  else
-  {
-    memcpy (buff, buffer, length);
-  }
   
   // checks if fd is set to write to the console
   if (fd == STDOUT_FILENO) {
-    int written_bytes_acc = 0;
-    // Write to the console all of buffer in one call to putbuf(), at least
-    // as long as the size is not bigger than a few hundred bytes.
-    while (length >= 256) {
-       putbuf(buff , 256);
-       length -= 256;
-       written_bytes_acc += 256;
+    const uint8_t *buff = buffer;
+    unsigned left = length;
+    while (left > 0) {
+      unsigned chunk = pin_chunk (buff, left);
+      pin_user_buffer (buff, chunk, false);
+      // The pages are pinned, so the console can copy straight from
+      // them, taking the console lock once for the whole chunk.
+      putbuf ((const char *) buff, chunk);
+      unpin_user_buffer (buff, chunk);
+      buff += chunk;
+      left -= chunk;
     }
-    putbuf (buff, length);
-    free (buff);
-    return written_bytes_acc += length;
+    return length;
   }
 
-  lock_acquire (&filesystem_lock);  
-  
   struct file *file_ptr = get_corresponding_file (fd);
 
-  if (!file_ptr) {
-    lock_release (&filesystem_lock);
-    free (buff);
+  if (!file_ptr || isdir (fd))
     return -1;
+
+  return file_transfer (file_ptr, (void *) buffer, length, false);
+}
+
+/* Returns how many of the LENGTH bytes at user address BUFFER to
+   pin at once: up to the end of the frame_pin_max()'th page, so
+   that one large request cannot pin too many frames. */
+static unsigned
+pin_chunk (const void *buffer, unsigned length)
+{
+  unsigned chunk = frame_pin_max () * PGSIZE - pg_ofs (buffer);
+  return chunk < length ? chunk : length;
+}
+
+/* Returns the number of pages spanned by the SIZE bytes at
+   BUFFER. */
+static size_t
+buffer_page_cnt (const void *buffer, size_t size)
+{
+  return ((uint8_t *) pg_round_up ((uint8_t *) buffer + size)
+          - (uint8_t *) pg_round_down (buffer)) / PGSIZE;
+}
+
+/* Faults in and pins every page of the user buffer of SIZE bytes
+   at BUFFER, which must span at most frame_pin_max() pages, so
+   that the kernel can copy to it (if WRITABLE) or from it
+   directly, without page faults and without its frames being
+   evicted.  Terminates the process if any of the buffer is not
+   mapped, or is read-only and WRITABLE is true. */
+static void
+pin_user_buffer (const void *buffer, size_t size, bool writable)
+{
+  struct page_table *page_table = thread_current ()->page_table;
+  uint8_t *start = pg_round_down (buffer);
+  uint8_t *end = (uint8_t *) buffer + size;
+  uint8_t *upage;
+
+  frame_pin_reserve (buffer_page_cnt (buffer, size));
+  for (upage = start; upage < end; upage += PGSIZE)
+  {
+    /* Touch the page first: that validates it, grows the stack
+       if need be, and creates its supplemental page. */
+    struct page *page = NULL;
+    if (get_user (upage) != -1)
+      page = locate_page (upage, page_table);
+    if (!page || (writable && !page->writable))
+    {
+      if (upage > start)
+        unpin_user_buffer (start, upage - start);
+      frame_pin_release (buffer_page_cnt (buffer, size)
+                         - buffer_page_cnt (start, upage - start));
+      exit (-1);
+    }
+    frame_set_pinned (page, true);
+
+    /* It may have been evicted before it was pinned. */
+    get_user (upage);
   }
+}
 
-  int bytesWritten = file_write (file_ptr, buff, length); 
-  
-  lock_release (&filesystem_lock);
-  
-  free (buff);
-  
-  return bytesWritten;
+/* Unpins the pages of a buffer pinned by pin_user_buffer(). */
+static void
+unpin_user_buffer (const void *buffer, size_t size)
+{
+  struct page_table *page_table = thread_current ()->page_table;
+  uint8_t *upage = pg_round_down (buffer);
+  uint8_t *end = (uint8_t *) buffer + size;
+
+  for (; upage < end; upage += PGSIZE)
+  {
+    struct page *page = locate_page (upage, page_table);
+    if (page)
+      frame_set_pinned (page, false);
+  }
+  frame_pin_release (buffer_page_cnt (buffer, size));
+}
+
+/* Reads LENGTH bytes from FILE into user BUFFER if READING,
+   otherwise writes them from BUFFER to FILE, copying directly
+   between the buffer cache and the user's pages a pinned chunk
+   at a time.  Returns the number of bytes transferred. */
+static int
+file_transfer (struct file *file, void *buffer, unsigned length,
+               bool reading)
+{
+  uint8_t *buff = buffer;
+  int total = 0;
+
+  while (length > 0)
+  {
+    unsigned chunk = pin_chunk (buff, length);
+    pin_user_buffer (buff, chunk, reading);
+    off_t done = reading ? file_read (file, buff, chunk)
+                         : file_write (file, buff, chunk);
+    unpin_user_buffer (buff, chunk);
+
+    total += done;
+    if ((unsigned) done < chunk)
+      break;
+    buff += chunk;
+    length -= chunk;
+  }
+  return total;
 }
 
 /* Changes the next byte to be read or written in open file fd to position, 
@@ -373,13 +438,9 @@ expressed in bytes from the beginning of the file. */
 static void 
 seek (int fd, unsigned position)
 {
-  lock_acquire (&filesystem_lock);
-  
   struct file *file_ptr = get_corresponding_file (fd);
   int32_t new_pos = (int32_t) position;
   file_seek (file_ptr, new_pos);
-  
-  lock_release (&filesystem_lock);
 }
 
 /* Returns the position of the next byte to be read or written in open file fd, 
@@ -387,13 +448,9 @@ expressed in bytes from the beginning of the file. */
 static unsigned 
 tell (int fd)
 {
-  lock_acquire (&filesystem_lock);
-  
   struct file *file_ptr = get_corresponding_file (fd);
   int32_t next_byte_pos = file_tell (file_ptr);
   
-  lock_release (&filesystem_lock);
-  
   return (uint32_t) next_byte_pos;
 }
 
@@ -401,8 +458,6 @@ tell (int fd)
 static void 
 close (int fd)
 {
-  lock_acquire(&filesystem_lock);
-  
   struct file *open_file = get_corresponding_file (fd);
   
   struct list *files = &thread_current ()->file_list;
@@ -413,13 +468,104 @@ close (int fd)
     struct fd_map *current_fd_map = list_entry (e, struct fd_map, elem);
     if (current_fd_map->fd == fd){
       list_remove (&current_fd_map->elem);
+      dir_close (current_fd_map->dir);
       free (current_fd_map);
       break;
     }
   }
   file_close (open_file);
+}
+
+/* Changes the current working directory of the process to dir,
+   which may be relative or absolute. Returns true if successful,
+   false on failure. */
+static bool
+chdir (const char *dir)
+{
+  if (!filename_valid (dir))
+    return false;
+
+  return filesys_chdir (dir);
+}
+
+/* Creates the directory named dir, which may be relative or
+   absolute. Returns true if successful, false on failure. */
+static bool
+mkdir (const char *dir)
+{
+  if (!filename_valid (dir))
+    return false;
+
+  return filesys_mkdir (dir);
+}
+
+/* Reads a directory entry from file descriptor fd, which must
+   represent a directory, into name. Returns true if successful,
+   false if no entries are left or fd is not a directory. */
+static bool
+readdir (int fd, char *name)
+{
+  struct fd_map *fd_map = get_fd_map (fd);
+  char entry[NAME_MAX + 1];
+
+  if (!fd_map || !fd_map->dir)
+    return false;
+  if (!dir_readdir (fd_map->dir, entry))
+    return false;
+
+  for (size_t i = 0; i <= strlen (entry); ++i)
+  {
+    if (!put_user ((uint8_t *) name + i, entry[i]))
+      exit (-1);
+  }
+  return true;
+}
+
+/* Returns true if fd represents a directory, false if it
+   represents an ordinary file. */
+static bool
+isdir (int fd)
+{
+  struct fd_map *fd_map = get_fd_map (fd);
+
+  return fd_map != NULL && fd_map->dir != NULL;
+}
+
+/* Returns the inode number of the file or directory open as fd. */
+static int
+inumber (int fd)
+{
+  struct file *file_ptr = get_corresponding_file (fd);
+
+  if (!file_ptr)
+    return -1;
 
-  lock_release (&filesystem_lock);
+  return inode_get_inumber (file_get_inode (file_ptr));
+}
+
+/* Copies the statistics for block device number idx, counting
+   from 0 in probe order, into stats.  Returns false if there is
+   no such device. */
+static bool
+iostat (int idx, struct iostat *stats)
+{
+  struct block *block = block_first ();
+  struct iostat kstats;
+
+  if (idx < 0)
+    return false;
+  for (; block != NULL && idx > 0; idx--)
+    block = block_next (block);
+  if (block == NULL)
+    return false;
+
+  block_get_stats (block, &kstats);
+  for (size_t i = 0; i < sizeof kstats; ++i)
+  {
+    if (!put_user ((uint8_t *) stats + i, ((uint8_t *) &kstats)[i]))
+      exit (-1);
+  }
+  return true;
 }
 
 /* Maps file fd to process' virtual memory starting at address addr. */
@@ -446,36 +592,26 @@ mmap (int fd, void *addr)
 
   int offset = 0;
 
-  lock_acquire (&filesystem_lock);
-
   int remaining_length = file_length (new_fp);
   
-  if (!remaining_length) {
-    lock_release (&filesystem_lock);
+  if (!remaining_length)
     return MMAP_ERROR;
-  }
 
   int pages = remaining_length/PGSIZE + (remaining_length % PGSIZE != 0);
 
   /* Check that pending mapping will not overlap existing mappings */ 
   for (int i = 0; i < pages; i++) {
-    if (locate_page ((uint8_t *) addr + (i * PGSIZE), thread_current ()->page_table) != NULL) {
-      lock_release (&filesystem_lock);
+    if (locate_page ((uint8_t *) addr + (i * PGSIZE), thread_current ()->page_table) != NULL)
       return MMAP_ERROR;
-    }
   }
 
   /* Add mapping to thread's list of mappings */ 
   struct m_map *mapping = malloc (sizeof (struct m_map));
 
-  if (!mapping) {
-    lock_release (&filesystem_lock);
+  if (!mapping)
     return MMAP_ERROR; 
-  }
 
   mapping->mapid = thread_current ()->mapid_incr++;
-  
-  lock_release (&filesystem_lock);
 
   mapping->addr = addr;
   mapping->fp = new_fp;
@@ -522,11 +658,8 @@ munmap (mapid_t mapid)
 
   /* Only writes modified pages back to the file */
   for (int i = 0; i < mmap->page_cnt; i++) {
-    if (pagedir_is_dirty (thread_current ()->pagedir, (uint8_t *) mmap->addr + PGSIZE * i)) {
-      lock_acquire (&filesystem_lock);
+    if (pagedir_is_dirty (thread_current ()->pagedir, (uint8_t *) mmap->addr + PGSIZE * i))
       file_write_at (mmap->fp, mmap->addr + PGSIZE * i, PGSIZE, PGSIZE * i);
-      lock_release (&filesystem_lock);
-    }
     remove_page ((uint8_t *) mmap->addr + PGSIZE * i, thread_current ()->page_table);
   }
   
@@ -565,11 +698,10 @@ munmap_all (void) {
   }
 }
 
-/* Initialises system call handler and file system lock. */
+/* Initialises system call handler. */
 void
 syscall_init (void) 
 {
-  lock_init (&filesystem_lock);
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -636,6 +768,24 @@ syscall_handler (struct intr_frame *f)
     case SYS_MUNMAP:
       munmap ((mapid_t) first_arg(f));
       break;
+    case SYS_CHDIR:
+      f->eax = chdir ((const char *) first_arg(f));
+      break;
+    case SYS_MKDIR:
+      f->eax = mkdir ((const char *) first_arg(f));
+      break;
+    case SYS_READDIR:
+      f->eax = readdir ((int) first_arg(f), second_arg(f));
+      break;
+    case SYS_ISDIR:
+      f->eax = isdir ((int) first_arg(f));
+      break;
+    case SYS_INUMBER:
+      f->eax = inumber ((int) first_arg(f));
+      break;
+    case SYS_IOSTAT:
+      f->eax = iostat ((int) first_arg(f), second_arg(f));
+      break;
     default:
       /* Will terminate the current user process if an 
         invalid system call is used */
@@ -7,6 +7,7 @@
 struct fd_map {
   int fd;                                 /* File descriptor. */
   struct file *fp;                        /* File pointer matching fd. */
+  struct dir *dir;                        /* Directory, if fp is one. */
   struct list_elem elem;                  /* List elem. */
 };
 
@@ -9,8 +9,19 @@
 #include "userprog/pagedir.h"
 #include "vm/locklist.h"
 
+/* Number of frames in the frame table. */
+#define FRAME_CNT 367
+
+/* Most user pages that may be pinned at once, over all threads.
+   Keeping it well below FRAME_CNT means a page fault always finds
+   a frame to evict, however many buffers the kernel has pinned. */
+#define PIN_LIMIT (FRAME_CNT / 2)
+
 struct frametable table;    /* Frame table. */
-struct lock frame_lock;     /* Frame lock. */
+struct lock frame_lock;     /* Frame lock: eviction and pinning. */
+
+static struct condition pin_cond;   /* Signalled when pins are freed. */
+static size_t pin_cnt;              /* Pages pinned or reserved. */
 
 extern uint32_t init_ram_pages;
 
@@ -20,7 +31,8 @@ frametable_init (void)
 { 
   locklist_init (&table.frames);
   lock_init (&frame_lock);
-  for (int i = 0; i < 367; ++i)
+  cond_init (&pin_cond);
+  for (int i = 0; i < FRAME_CNT; ++i)
   {
     struct frame *f = malloc (sizeof (struct frame));
     if (!f)
@@ -46,7 +58,7 @@ frametable_free (void)
   while (e != locklist_end (&table.frames))
   {
     struct locklist_elem *next = locklist_remove (e);
-    lock_release (&e->lock);
+    adaptive_lock_release (&e->lock);
     free (list_entry (e, struct frame, elem));
     e = next;
   } 
@@ -66,20 +78,24 @@ locate_frame (void *page, struct inode *node)
       return f;
     }
   }
-  lock_release (&table.frames.tail.prev->lock); 
-  lock_release (&table.frames.tail.lock);
+  adaptive_lock_release (&table.frames.tail.prev->lock); 
+  adaptive_lock_release (&table.frames.tail.lock);
   return NULL;
 }
 
-/* Allocates a page to a frame. */
+/* Allocates a page to a frame.  Frames holding a pinned page
+   are never evicted.  Holds frame_lock from the pinned check to
+   the eviction, so that a page cannot be pinned in between. */
 struct frame *
 find_free_frame (void) 
 {
+  lock_acquire (&frame_lock);
   for (struct locklist_elem *e = locklist_begin (&table.frames);
        e != locklist_end (&table.frames);
        e = locklist_next (e))
   {
     struct frame *f = list_entry (e, struct frame, elem);
+    bool pinned = false;
     if (!f->accessed)
     {
       for (struct locklist_elem *ep = locklist_begin (&f->page_list);
@@ -87,30 +103,85 @@ find_free_frame (void)
            ep = locklist_next (ep))
       {
         struct page *page = list_entry (ep, struct page, page_elem);
+        if (page->pinned)
+          pinned = true;
         if (pagedir_is_accessed (page->t->pagedir, page->addr))
         {
           f->accessed = true;
           pagedir_set_accessed (page->t->pagedir, page->addr, false);
         }
       }
-      lock_release (&f->page_list.tail.prev->lock);    
-      lock_release (&f->page_list.tail.lock);    
+      adaptive_lock_release (&f->page_list.tail.prev->lock);    
+      adaptive_lock_release (&f->page_list.tail.lock);    
     }
     if (!f->page)
+    {
+      lock_release (&frame_lock);
       return f;
+    }
     else if (f->accessed)
       f->accessed = false;  
-    else
+    else if (!pinned)
     {
       evict_to_swap (f);
+      lock_release (&frame_lock);
       return f;
     }
   }
-  lock_release (&table.frames.tail.prev->lock);
-  lock_release (&table.frames.tail.lock);
+  adaptive_lock_release (&table.frames.tail.prev->lock);
+  adaptive_lock_release (&table.frames.tail.lock);
+  lock_release (&frame_lock);
   return NULL;
 }
 
+/* Returns the most pages that one caller may pin at once with
+   frame_pin_reserve(). */
+size_t
+frame_pin_max (void)
+{
+  return PIN_LIMIT / 4;
+}
+
+/* Reserves PAGE_CNT pins, at most frame_pin_max(), waiting until
+   enough pinned pages have been unpinned if need be.  A caller
+   reserves all the pages it will pin before pinning any of them,
+   so that threads waiting here never hold pins themselves. */
+void
+frame_pin_reserve (size_t page_cnt)
+{
+  ASSERT (page_cnt <= frame_pin_max ());
+
+  lock_acquire (&frame_lock);
+  while (pin_cnt + page_cnt > PIN_LIMIT)
+    cond_wait (&pin_cond, &frame_lock);
+  pin_cnt += page_cnt;
+  lock_release (&frame_lock);
+}
+
+/* Gives back PAGE_CNT pins reserved by frame_pin_reserve(), whose
+   pages must already have been unpinned. */
+void
+frame_pin_release (size_t page_cnt)
+{
+  lock_acquire (&frame_lock);
+  ASSERT (pin_cnt >= page_cnt);
+  pin_cnt -= page_cnt;
+  cond_broadcast (&pin_cond, &frame_lock);
+  lock_release (&frame_lock);
+}
+
+/* Marks PAGE pinned, or unpinned if PINNED is false.  Takes
+   frame_lock, under which find_free_frame() checks for pinned
+   pages, so that a frame it has chosen to evict is not pinned
+   before the eviction finishes. */
+void
+frame_set_pinned (struct page *page, bool pinned)
+{
+  lock_acquire (&frame_lock);
+  page->pinned = pinned;
+  lock_release (&frame_lock);
+}
+
 struct frame *
 alloc_frame (struct page *page, bool writable, struct inode *node, bool *shared)
 {
@@ -121,20 +192,20 @@ alloc_frame (struct page *page, bool writable, struct inode *node, bool *shared)
     if (f && !f->writable) 
     {
       f->num_refs++;
-      lock_acquire (&page->page_elem.lock);
+      adaptive_lock_acquire (&page->page_elem.lock);
       locklist_push_back (&f->page_list, &page->page_elem);
-      lock_release (&page->page_elem.lock);
+      adaptive_lock_release (&page->page_elem.lock);
       *shared = true;
-      lock_release (&f->elem.prev->lock);
-      lock_release (&f->elem.lock);
-      lock_release (&f->elem.next->lock);
+      adaptive_lock_release (&f->elem.prev->lock);
+      adaptive_lock_release (&f->elem.lock);
+      adaptive_lock_release (&f->elem.next->lock);
       return f;
     }
     if (f)
     {
-      lock_release (&f->elem.prev->lock);
-      lock_release (&f->elem.lock);
-      lock_release (&f->elem.next->lock);
+      adaptive_lock_release (&f->elem.prev->lock);
+      adaptive_lock_release (&f->elem.lock);
+      adaptive_lock_release (&f->elem.next->lock);
     }
   }
 
@@ -144,19 +215,19 @@ alloc_frame (struct page *page, bool writable, struct inode *node, bool *shared)
   
   if (f) {
     locklist_remove (&f->elem);
-    lock_release (&f->elem.prev->lock);
-    lock_release (&f->elem.next->lock);
+    adaptive_lock_release (&f->elem.prev->lock);
+    adaptive_lock_release (&f->elem.next->lock);
     if (f->elem.next->next != NULL)
-      lock_release (&f->elem.next->next->lock);
+      adaptive_lock_release (&f->elem.next->next->lock);
     locklist_push_back (&table.frames, &f->elem);
-    lock_acquire (&page->page_elem.lock);
+    adaptive_lock_acquire (&page->page_elem.lock);
     locklist_push_back (&f->page_list, &page->page_elem);
-    lock_release (&page->page_elem.lock);
+    adaptive_lock_release (&page->page_elem.lock);
     f->page = page->addr;
     f->writable = writable;
     f->num_refs++;
     f->file_node = node;
-    lock_release (&f->elem.lock);
+    adaptive_lock_release (&f->elem.lock);
     return f;
   }
   PANIC ("alloc_frame: no free frames!"); 
@@ -179,8 +250,8 @@ free_frame (void *kpage)
   }
 
   if (!f) {
-    lock_release (&table.frames.tail.prev->lock);
-    lock_release (&table.frames.tail.lock);
+    adaptive_lock_release (&table.frames.tail.prev->lock);
+    adaptive_lock_release (&table.frames.tail.lock);
     return;
   }
 
@@ -191,33 +262,33 @@ free_frame (void *kpage)
     if (page->t == thread_current ())
     {
       locklist_remove (&page->page_elem);
-      lock_release (&e->prev->lock);
-      lock_release (&e->next->lock);
+      adaptive_lock_release (&e->prev->lock);
+      adaptive_lock_release (&e->next->lock);
       if (e->next->next != NULL)
-        lock_release (&e->next->next->lock);
+        adaptive_lock_release (&e->next->next->lock);
       break;
     } else
     {
       e = locklist_next (e);
     }
   }
-  lock_release (&e->lock);
+  adaptive_lock_release (&e->lock);
   ASSERT (e != locklist_end (&f->page_list));
 
   if (--f->num_refs){
-    lock_release (&f->elem.prev->lock);
-    lock_release (&f->elem.lock);
-    lock_release (&f->elem.next->lock);
+    adaptive_lock_release (&f->elem.prev->lock);
+    adaptive_lock_release (&f->elem.lock);
+    adaptive_lock_release (&f->elem.next->lock);
     return;
   }
 
   f->page = NULL;
   f->file_node = NULL;
   locklist_remove (&f->elem);
-  lock_release (&f->elem.prev->lock);
-  lock_release (&f->elem.next->lock);
+  adaptive_lock_release (&f->elem.prev->lock);
+  adaptive_lock_release (&f->elem.next->lock);
   if (f->elem.next->next != NULL)
-    lock_release (&f->elem.next->next->lock);
+    adaptive_lock_release (&f->elem.next->next->lock);
   locklist_push_front (&table.frames, &f->elem);
-  lock_release (&f->elem.lock); 
+  adaptive_lock_release (&f->elem.lock); 
 }
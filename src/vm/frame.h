@@ -31,6 +31,11 @@ struct frame *locate_frame (void *page, struct inode *node);
 
 struct frame *find_free_frame (void);
 
+size_t frame_pin_max (void);
+void frame_pin_reserve (size_t page_cnt);
+void frame_pin_release (size_t page_cnt);
+void frame_set_pinned (struct page *page, bool pinned);
+
 void free_frame (void *kpage);
 
 #endif /* vm/frame.h */
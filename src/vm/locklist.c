@@ -14,7 +14,7 @@ locklist_init (struct locklist *list)
 void
 elem_init (struct locklist_elem *e)
 {
-  lock_init (&e->lock); 
+  adaptive_lock_init (&e->lock, ADAPTIVE_SPIN_DEFAULT); 
 }
 
 /*
@@ -25,10 +25,10 @@ If A is tail do not acquire B
 struct locklist_elem *
 locklist_begin (struct locklist *list)
 {
-  lock_acquire (&list->head.lock); 
-  lock_acquire (&list->head.next->lock);
+  adaptive_lock_acquire (&list->head.lock); 
+  adaptive_lock_acquire (&list->head.next->lock);
   if (list->head.next != &list->tail)
-    lock_acquire (&list->head.next->next->lock);
+    adaptive_lock_acquire (&list->head.next->next->lock);
   return list->head.next;
 }
 
@@ -41,9 +41,9 @@ If C is end of list do not acquire D
 struct locklist_elem *
 locklist_next (struct locklist_elem *e)
 {
-  lock_release (&e->prev->lock);
+  adaptive_lock_release (&e->prev->lock);
   if (e->next->next != NULL)
-    lock_acquire (&e->next->next->lock);
+    adaptive_lock_acquire (&e->next->next->lock);
   return e->next;
 }
 
@@ -61,15 +61,15 @@ Not sure if we should lock e?
 void
 locklist_push_front (struct locklist *list, struct locklist_elem *e)
 {
-  lock_acquire (&list->head.lock);
-  lock_acquire (&list->head.next->lock);
+  adaptive_lock_acquire (&list->head.lock);
+  adaptive_lock_acquire (&list->head.next->lock);
   struct locklist_elem *next = list->head.next;
   list->head.next = e;
   e->prev = &list->head;
   e->next = next;
   next->prev = e;
-  lock_release (&list->head.lock);
-  lock_release (&next->lock); 
+  adaptive_lock_release (&list->head.lock);
+  adaptive_lock_release (&next->lock); 
 }
 
 /*
@@ -80,15 +80,15 @@ Not sure if we should lock e?
 void
 locklist_push_back (struct locklist *list, struct locklist_elem *e)
 {
-  lock_acquire (&list->tail.prev->lock);
-  lock_acquire (&list->tail.lock);
+  adaptive_lock_acquire (&list->tail.prev->lock);
+  adaptive_lock_acquire (&list->tail.lock);
   struct locklist_elem *prev = list->tail.prev;
   prev->next = e;
   e->prev = prev;
   e->next = &list->tail;
   list->tail.prev = e;
-  lock_release (&prev->lock); 
-  lock_release (&list->tail.lock);
+  adaptive_lock_release (&prev->lock); 
+  adaptive_lock_release (&list->tail.lock);
 }
 
 /*
@@ -101,7 +101,7 @@ struct locklist_elem *
 locklist_remove (struct locklist_elem *e)
 {
   if (e->next->next != NULL)
-    lock_acquire (&e->next->next->lock); 
+    adaptive_lock_acquire (&e->next->next->lock); 
   struct locklist_elem *prev = e->prev;
   struct locklist_elem *next = e->next;
   prev->next = next;
@@ -117,16 +117,16 @@ Undefined behaviour if list is empty.
 struct locklist_elem *
 locklist_pop_front (struct locklist *list)
 {
-  lock_acquire (&list->head.lock);
-  lock_acquire (&list->head.next->lock);
-  lock_acquire (&list->head.next->next->lock);
+  adaptive_lock_acquire (&list->head.lock);
+  adaptive_lock_acquire (&list->head.next->lock);
+  adaptive_lock_acquire (&list->head.next->next->lock);
   struct locklist_elem *first = list->head.next;
   struct locklist_elem *second = first->next;
   list->head.next = second;
   second->prev = &list->head;
-  lock_release (&list->head.lock);
-  lock_release (&first->lock);
-  lock_release (&second->lock);
+  adaptive_lock_release (&list->head.lock);
+  adaptive_lock_release (&first->lock);
+  adaptive_lock_release (&second->lock);
   return first;
 }
 
@@ -138,16 +138,16 @@ Undefined behaviour if list is empty.
 struct locklist_elem *
 locklist_pop_back (struct locklist *list)
 {
-  lock_acquire (&list->tail.prev->prev->lock);
-  lock_acquire (&list->tail.prev->lock);
-  lock_acquire (&list->tail.lock);
+  adaptive_lock_acquire (&list->tail.prev->prev->lock);
+  adaptive_lock_acquire (&list->tail.prev->lock);
+  adaptive_lock_acquire (&list->tail.lock);
   struct locklist_elem *first = list->tail.prev->prev;
   struct locklist_elem *second = list->tail.prev;
   first->next = &list->tail;
   list->tail.prev = first;
-  lock_release (&first->lock);
-  lock_release (&second->lock);
-  lock_release (&list->tail.lock);
+  adaptive_lock_release (&first->lock);
+  adaptive_lock_release (&second->lock);
+  adaptive_lock_release (&list->tail.lock);
   return second;
 }
 
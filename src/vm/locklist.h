@@ -11,7 +11,7 @@ struct locklist_elem
   {
     struct locklist_elem *prev;     /* Previous list element. */
     struct locklist_elem *next;     /* Next list element. */
-    struct lock lock;
+    struct adaptive_lock lock;      /* Held only briefly. */
   };
 
 /* List. */
@@ -33,7 +33,7 @@ pagetable_init (void)
 {
   struct page_table *page_table = malloc(sizeof(struct page_table));
   hash_init (&page_table->table, page_hash, page_less, NULL);
-  lock_init (&page_table->lock);
+  rw_lock_init (&page_table->lock);
   return page_table;
 }
 
@@ -44,9 +44,9 @@ locate_page (void *addr, struct page_table *page_table)
   void *page = pg_round_down (addr); 
   struct page temp; 
   temp.addr = page;
-  lock_acquire (&page_table->lock);
+  rw_lock_acquire_read_adaptive (&page_table->lock, ADAPTIVE_SPIN_DEFAULT);
   struct hash_elem *e = hash_find (&page_table->table, &temp.elem);
-  lock_release (&page_table->lock);
+  rw_lock_release_read (&page_table->lock);
   if (!e)
   {
     return NULL;  
@@ -69,11 +69,12 @@ add_page (void *addr, void *data, enum page_status status, struct page_table *pa
   page->data = data;
   page->status = status;
   page->writable = writable;
+  page->pinned = false;
   page->t = thread_current ();
   elem_init (&page->page_elem);
-  lock_acquire (&page_table->lock);
+  rw_lock_acquire_write (&page_table->lock);
   hash_insert (&page_table->table, &page->elem);
-  lock_release (&page_table->lock);
+  rw_lock_release_write (&page_table->lock);
 }
 
 /* Removes the supplemental page with addr from thread's supplemental page table. */
@@ -83,7 +84,7 @@ remove_page (void *addr, struct page_table *page_table)
   struct page *page = locate_page (addr, page_table); 
   if (!page)
     return;
-  lock_acquire (&page_table->lock);
+  rw_lock_acquire_write (&page_table->lock);
   switch (page->status)
   { 
     case FRAME:
@@ -99,7 +100,7 @@ remove_page (void *addr, struct page_table *page_table)
   }
   pagedir_clear_page (page->t->pagedir, addr);
   hash_delete (&page_table->table, &page->elem);
-  lock_release (&page_table->lock);
+  rw_lock_release_write (&page_table->lock);
   free (page);
 }
 
@@ -107,7 +108,7 @@ static void
 page_remove (struct hash_elem *e, void *aux UNUSED)
 {
   struct page *page = hash_entry (e, struct page, elem);
-  lock_acquire (&page->t->page_table->lock);
+  rw_lock_acquire_write (&page->t->page_table->lock);
   switch (page->status)
   { 
     case FRAME:
@@ -123,7 +124,7 @@ page_remove (struct hash_elem *e, void *aux UNUSED)
   }
   pagedir_clear_page (page->t->pagedir, page->addr);
   hash_delete (&page->t->page_table->table, &page->elem);
-  lock_release (&page->t->page_table->lock);
+  rw_lock_release_write (&page->t->page_table->lock);
   free (page);
 }
 
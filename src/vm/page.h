@@ -35,6 +35,7 @@ struct page
   void *data;                     /* Data depending on page_status. */
   struct thread *t;               /* Thread owning the supplemental page table. */
   bool writable;                  /* Writable. */
+  bool pinned;                    /* Kernel is accessing it; don't evict. */
   struct inode *node;             /* Inode. */
   struct locklist_elem page_elem; /* Used to store page in frame page_list. */
   struct list_elem swap_elem;     /* Used to store page in swap page_list. */
@@ -44,7 +45,7 @@ struct page
 struct page_table
 {
   struct hash table;
-  struct lock lock;
+  struct rw_lock lock;            /* Readers: locate_page(). */
 };
 
 struct page_table *pagetable_init (void);
@@ -1,4 +1,5 @@
 #include <inttypes.h>
+#include <stdio.h>
 #include "swap.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
@@ -8,15 +9,25 @@
 #include "vm/frame.h"
 
 struct swap table2;
-struct lock swap_lock;
+struct adaptive_lock swap_lock;
 struct block *swap;
 
+/* Statistics. */
+static long long mem_out_cnt;   /* # of pages evicted to zswap. */
+static long long disk_out_cnt;  /* # of pages evicted to disk. */
+static long long mem_in_cnt;    /* # of pages faulted in from zswap. */
+static long long disk_in_cnt;   /* # of pages faulted in from disk. */
+
 static struct swapslot *pop_free_slot(void);
+static struct swapslot *pop_mem_slot (void);
+static void release_slot (struct swapslot *);
 
 /* Initialise swap table. */
 void swaptable_init(void){
   list_init(&table2.slots);
-  lock_init(&swap_lock);
+  list_init(&table2.mem_slots);
+  adaptive_lock_init (&swap_lock, ADAPTIVE_SPIN_DEFAULT);
+  zswap_init ();
 
   swap = block_get_role(BLOCK_SWAP);
   for (uint32_t i = 0; i < block_size(swap); i+=PGSIZE/BLOCK_SECTOR_SIZE){
@@ -25,6 +36,7 @@ void swaptable_init(void){
     	PANIC("Failed to allocate swapslot\n");
     }
     slot->sector = i; 
+    slot->in_memory = false;
     list_init (&slot->page_list);
     sema_init (&slot->sema, 1);
     list_push_back(&table2.slots, &slot->elem);
@@ -39,19 +51,22 @@ void swaptable_free(void){
     free(list_entry(e, struct swapslot, elem));
     e = next; 
   }
+  while (!list_empty (&table2.mem_slots))
+    free (list_entry (list_pop_front (&table2.mem_slots),
+                      struct swapslot, elem));
 }
 
 /* Free swap slot. */
 void free_swapslot(struct swapslot *slot, struct page *page){
-  lock_acquire (&swap_lock);
+  adaptive_lock_acquire (&swap_lock);
   list_remove (&page->swap_elem); 
   if (--slot->num_refs)
   {
-    lock_release (&swap_lock);
+    adaptive_lock_release (&swap_lock);
     return;
   }
-  list_push_back (&table2.slots, &slot->elem);
-  lock_release (&swap_lock);
+  release_slot (slot);
+  adaptive_lock_release (&swap_lock);
 }
 
 /* Returns pointer to first swap slot. */
@@ -66,18 +81,65 @@ pop_free_slot(void)
   return NULL;
 }
 
-/* Evicts the given frame to the swap */
+/* Returns a slot for a page kept by zswap, reusing a free one if
+   possible.  swap_lock must be held. */
+static struct swapslot *
+pop_mem_slot (void)
+{
+  struct swapslot *slot;
+
+  if (!list_empty (&table2.mem_slots))
+    return list_entry (list_pop_front (&table2.mem_slots),
+                       struct swapslot, elem);
+
+  slot = malloc (sizeof *slot);
+  if (slot == NULL)
+    PANIC ("Failed to allocate swapslot\n");
+  slot->in_memory = true;
+  list_init (&slot->page_list);
+  sema_init (&slot->sema, 1);
+  return slot;
+}
+
+/* Returns SLOT, which no page refers to any longer, to the free
+   list it came from.  swap_lock must be held. */
+static void
+release_slot (struct swapslot *slot)
+{
+  if (slot->in_memory)
+    {
+      zswap_free (&slot->zswap);
+      list_push_back (&table2.mem_slots, &slot->elem);
+    }
+  else
+    list_push_back (&table2.slots, &slot->elem);
+}
+
+/* Evicts the given frame to the swap.  The page is kept
+   compressed in memory by zswap if possible, and written to the
+   swap device otherwise. */
 void
 evict_to_swap(struct frame *frame)
 {
-  lock_acquire (&swap_lock);
-  struct swapslot *free_slot = pop_free_slot ();
-  if (free_slot == NULL){
-    PANIC ("Swap is full!!!");
-  } 
-  for (int i = 0; i < PGSIZE/BLOCK_SECTOR_SIZE; i++){
-    block_write (swap, free_slot->sector + i, frame->kPage + (BLOCK_SECTOR_SIZE * i));
-  }
+  struct zswap_entry zswap;
+  struct swapslot *free_slot;
+
+  adaptive_lock_acquire (&swap_lock);
+  if (zswap_store (frame->kPage, &zswap))
+    {
+      free_slot = pop_mem_slot ();
+      free_slot->zswap = zswap;
+      mem_out_cnt++;
+    }
+  else
+    {
+      free_slot = pop_free_slot ();
+      if (free_slot == NULL)
+        PANIC ("Swap is full!!!");
+      block_write_sectors (swap, free_slot->sector, frame->kPage,
+                           PGSIZE / BLOCK_SECTOR_SIZE);
+      disk_out_cnt++;
+    }
   frame->page = NULL;
   free_slot->num_refs = frame->num_refs;
   frame->num_refs = 0;
@@ -90,25 +152,33 @@ evict_to_swap(struct frame *frame)
     page->status = SWAP;
     page->data = free_slot;
     pagedir_clear_page (page->t->pagedir, page->addr);
-    lock_release (&e->lock);
+    adaptive_lock_release (&e->lock);
     e = next;
   }
   free_slot->sema.value = 1;
-  lock_release (&frame->page_list.head.lock);
-  lock_release (&frame->page_list.tail.lock);
-  lock_release(&swap_lock);
+  adaptive_lock_release (&frame->page_list.head.lock);
+  adaptive_lock_release (&frame->page_list.tail.lock);
+  adaptive_lock_release (&swap_lock);
 }
 
 /* Moves the frame back into a frame from the swap, uses page to get where it is stored on the swap disk */
 void get_from_swap(struct page *page, struct frame *frame){
-  lock_acquire(&swap_lock);
+  adaptive_lock_acquire (&swap_lock);
   ASSERT(page->status == SWAP);
   ASSERT(frame != NULL);
   struct swapslot *free_slot = (struct swapslot *) page->data;
-  list_push_back(&table2.slots, &free_slot->elem);
-  for (int i = 0; i< PGSIZE/BLOCK_SECTOR_SIZE; i++){
-    block_read(swap, free_slot->sector+i, frame->kPage+(BLOCK_SECTOR_SIZE*i));
-  }
+  if (free_slot->in_memory)
+    {
+      zswap_load (&free_slot->zswap, frame->kPage);
+      mem_in_cnt++;
+    }
+  else
+    {
+      block_read_sectors (swap, free_slot->sector, frame->kPage,
+                          PGSIZE / BLOCK_SECTOR_SIZE);
+      disk_in_cnt++;
+    }
+  release_slot (free_slot);
   struct list_elem *e = list_begin (&free_slot->page_list);
   while (e != list_end (&free_slot->page_list))
   {
@@ -123,9 +193,9 @@ void get_from_swap(struct page *page, struct frame *frame){
       continue;
     }
     pagedir_set_page (new_page->t->pagedir, new_page->addr, frame->kPage, new_page->writable);
-    lock_acquire (&new_page->page_elem.lock); 
+    adaptive_lock_acquire (&new_page->page_elem.lock); 
     locklist_push_back (&frame->page_list, &new_page->page_elem);
-    lock_release (&new_page->page_elem.lock); 
+    adaptive_lock_release (&new_page->page_elem.lock); 
     e = next;
   }
   for (int i = 0; i < free_slot->num_refs; ++i)
@@ -133,6 +203,15 @@ void get_from_swap(struct page *page, struct frame *frame){
     sema_up (&free_slot->sema);
   }
   frame->num_refs = free_slot->num_refs;
-  lock_release(&swap_lock);
+  adaptive_lock_release (&swap_lock);
 }
 
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  printf ("Swap: %lld pages out to memory, %lld to disk; "
+          "%lld pages in from memory, %lld from disk\n",
+          mem_out_cnt, disk_out_cnt, mem_in_cnt, disk_in_cnt);
+  zswap_print_stats ();
+}
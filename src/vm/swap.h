@@ -4,6 +4,7 @@
 #include "vm/page.h"
 #include "vm/frame.h"
 #include "devices/block.h"
+#include "vm/zswap.h"
 
 struct swapslot{
   struct list_elem elem;              /* List elem. */
@@ -11,10 +12,13 @@ struct swapslot{
   struct list page_list;              /* List of pages. */
   int num_refs;                       /* Number of references. */
   struct semaphore sema;              /* Swap slot semaphore. */
+  bool in_memory;                     /* Kept by zswap, not on disk? */
+  struct zswap_entry zswap;           /* Page contents, if in_memory. */
 };
 
 struct swap {
   struct list slots;		      /* Free sectors on swap */
+  struct list mem_slots;	      /* Free slots for zswap pages. */
 };
 
 void swaptable_init(void);
@@ -22,5 +26,6 @@ void swaptable_free(void);
 void free_swapslot(struct swapslot *slot, struct page *page);
 void evict_to_swap(struct frame *frame);
 void get_from_swap(struct page *page, struct frame *frame);
+void swap_print_stats(void);
 
 #endif /* vm/swap.h */
@@ -0,0 +1,289 @@
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed swap in memory.
+
+   Evicted pages are kept here, compressed, for as long as there
+   is room, so that faulting them back in costs a decompression
+   instead of a disk read.  Pages that consist of a single
+   repeated 32-bit word, zeroed pages most of all, take no arena
+   space at all.  Other pages are compressed with a simple LZ77
+   scheme and stored in a contiguous run of fixed-size chunks of
+   the arena.  A page that does not compress well or does not fit
+   is left for the swap device.
+
+   The compressed format is a sequence of tokens, each starting
+   with a control byte C.  If C < 0x80, it is followed by C + 1
+   literal bytes.  Otherwise it is followed by a 2-byte
+   little-endian offset, and means to copy (C & 0x7f) + MIN_MATCH
+   bytes starting that many bytes back in the output, which may
+   overlap the bytes being produced. */
+
+/* Arena pages to try to allocate, and fewest worth having. */
+#define ARENA_PAGES 64
+#define ARENA_MIN_PAGES 8
+
+/* Size of an arena chunk in bytes. */
+#define CHUNK_SIZE 64
+
+/* Largest compressed page worth keeping in memory. */
+#define MAX_ZSIZE (PGSIZE * 3 / 4)
+
+/* Compressor parameters. */
+#define MIN_MATCH 3
+#define MAX_MATCH (0x7f + MIN_MATCH)
+#define MAX_LITERALS 0x80
+#define HASH_BITS 10
+
+/* The arena, and a bitmap of its chunks in use. */
+static uint8_t *arena;
+static struct bitmap *used_chunks;
+
+/* Protects the arena and the compressor's state. */
+static struct lock zswap_lock;
+
+/* Compressor state.  For each hash of MIN_MATCH bytes, 1 plus
+   the last position in the page that had that hash, or 0. */
+static uint16_t hash_table[1 << HASH_BITS];
+static uint8_t zbuf[MAX_ZSIZE];
+
+/* Statistics. */
+static long long filled_cnt;    /* # of same-filled pages stored. */
+static long long compressed_cnt; /* # of compressed pages stored. */
+static long long compressed_bytes; /* Total size they compressed to. */
+static long long reject_cnt;    /* # of pages that did not compress. */
+static long long full_cnt;      /* # of pages refused for lack of room. */
+
+static size_t compress (const uint8_t *page);
+static void decompress (const uint8_t *src, size_t size, uint8_t *page);
+
+/* Allocates the arena from the kernel pool.  If memory is short,
+   takes a smaller arena, or works with same-filled pages only. */
+void
+zswap_init (void)
+{
+  size_t page_cnt;
+
+  lock_init (&zswap_lock);
+  for (page_cnt = ARENA_PAGES; page_cnt >= ARENA_MIN_PAGES; page_cnt /= 2)
+    {
+      arena = palloc_get_multiple (0, page_cnt);
+      if (arena != NULL)
+        break;
+    }
+  if (arena == NULL)
+    {
+      printf ("zswap: no memory for arena, storing same-filled pages only\n");
+      return;
+    }
+
+  used_chunks = bitmap_create (page_cnt * PGSIZE / CHUNK_SIZE);
+  if (used_chunks == NULL)
+    PANIC ("zswap: failed to allocate chunk bitmap");
+}
+
+/* Tries to keep a copy of PAGE in memory, filling in E to
+   describe it.  Returns true if successful, false if PAGE must
+   be written to the swap device instead. */
+bool
+zswap_store (const void *page, struct zswap_entry *e)
+{
+  const uint32_t *words = page;
+  size_t i, chunk_cnt;
+  bool success = false;
+
+  /* Same-filled pages need no storage. */
+  for (i = 1; i < PGSIZE / sizeof *words; i++)
+    if (words[i] != words[0])
+      break;
+  if (i == PGSIZE / sizeof *words)
+    {
+      e->size = 0;
+      e->fill = words[0];
+      lock_acquire (&zswap_lock);
+      filled_cnt++;
+      lock_release (&zswap_lock);
+      return true;
+    }
+
+  if (arena == NULL)
+    return false;
+
+  lock_acquire (&zswap_lock);
+  e->size = compress (page);
+  if (e->size == 0)
+    reject_cnt++;
+  else
+    {
+      chunk_cnt = DIV_ROUND_UP (e->size, CHUNK_SIZE);
+      e->chunk = bitmap_scan_and_flip (used_chunks, 0, chunk_cnt, false);
+      if (e->chunk == BITMAP_ERROR)
+        full_cnt++;
+      else
+        {
+          memcpy (arena + e->chunk * CHUNK_SIZE, zbuf, e->size);
+          compressed_cnt++;
+          compressed_bytes += e->size;
+          success = true;
+        }
+    }
+  lock_release (&zswap_lock);
+  return success;
+}
+
+/* Restores the page described by E into PAGE.  E remains valid
+   until passed to zswap_free(). */
+void
+zswap_load (const struct zswap_entry *e, void *page)
+{
+  if (e->size == 0)
+    {
+      uint32_t *words = page;
+      size_t i;
+
+      for (i = 0; i < PGSIZE / sizeof *words; i++)
+        words[i] = e->fill;
+    }
+  else
+    decompress (arena + e->chunk * CHUNK_SIZE, e->size, page);
+}
+
+/* Releases the memory used by E. */
+void
+zswap_free (struct zswap_entry *e)
+{
+  if (e->size > 0)
+    {
+      lock_acquire (&zswap_lock);
+      bitmap_set_multiple (used_chunks, e->chunk,
+                           DIV_ROUND_UP (e->size, CHUNK_SIZE), false);
+      lock_release (&zswap_lock);
+      e->size = 0;
+    }
+}
+
+/* Prints compressed swap statistics. */
+void
+zswap_print_stats (void)
+{
+  printf ("Zswap: %lld same-filled pages, %lld compressed pages "
+          "in %lld bytes, %lld incompressible, %lld refused for space\n",
+          filled_cnt, compressed_cnt, compressed_bytes, reject_cnt,
+          full_cnt);
+}
+
+/* Returns a hash of the MIN_MATCH bytes at P. */
+static unsigned
+hash_bytes (const uint8_t *p)
+{
+  uint32_t x = p[0] | (p[1] << 8) | (p[2] << 16);
+  return (x * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Appends the LEN literal bytes at SRC to zbuf at *OFS.  Returns
+   false if they do not fit. */
+static bool
+put_literals (const uint8_t *src, size_t len, size_t *ofs)
+{
+  while (len > 0)
+    {
+      size_t run = len < MAX_LITERALS ? len : MAX_LITERALS;
+      if (*ofs + 1 + run > MAX_ZSIZE)
+        return false;
+      zbuf[(*ofs)++] = run - 1;
+      memcpy (zbuf + *ofs, src, run);
+      *ofs += run;
+      src += run;
+      len -= run;
+    }
+  return true;
+}
+
+/* Compresses PAGE into zbuf.  Returns the compressed size, or 0
+   if that would exceed MAX_ZSIZE.  zswap_lock must be held. */
+static size_t
+compress (const uint8_t *page)
+{
+  size_t pos = 0, literal_start = 0, ofs = 0;
+
+  memset (hash_table, 0, sizeof hash_table);
+  while (pos + MIN_MATCH <= PGSIZE)
+    {
+      unsigned h = hash_bytes (page + pos);
+      size_t match = hash_table[h];
+      size_t len;
+
+      hash_table[h] = pos + 1;
+      if (match == 0 || memcmp (page + match - 1, page + pos, MIN_MATCH))
+        {
+          pos++;
+          continue;
+        }
+      match--;
+
+      len = MIN_MATCH;
+      while (pos + len < PGSIZE && len < MAX_MATCH
+             && page[match + len] == page[pos + len])
+        len++;
+
+      if (!put_literals (page + literal_start, pos - literal_start, &ofs)
+          || ofs + 3 > MAX_ZSIZE)
+        return 0;
+      zbuf[ofs++] = 0x80 | (len - MIN_MATCH);
+      zbuf[ofs++] = (pos - match) & 0xff;
+      zbuf[ofs++] = (pos - match) >> 8;
+      pos += len;
+      literal_start = pos;
+    }
+  if (!put_literals (page + literal_start, PGSIZE - literal_start, &ofs))
+    return 0;
+  return ofs;
+}
+
+/* Decompresses the SIZE bytes at SRC, produced by compress(),
+   into PAGE.  Panics if they are corrupt. */
+static void
+decompress (const uint8_t *src, size_t size, uint8_t *page)
+{
+  const uint8_t *end = src + size;
+  size_t pos = 0;
+
+  while (src < end)
+    {
+      uint8_t c = *src++;
+      if (c < 0x80)
+        {
+          size_t len = c + 1;
+          if (len > (size_t) (end - src) || pos + len > PGSIZE)
+            PANIC ("zswap: corrupt literal run");
+          memcpy (page + pos, src, len);
+          src += len;
+          pos += len;
+        }
+      else
+        {
+          size_t len = (c & 0x7f) + MIN_MATCH;
+          size_t back;
+
+          if (end - src < 2)
+            PANIC ("zswap: truncated match");
+          back = src[0] | (src[1] << 8);
+          src += 2;
+          if (back == 0 || back > pos || pos + len > PGSIZE)
+            PANIC ("zswap: corrupt match");
+
+          /* Byte by byte, since the copy may overlap itself. */
+          for (; len > 0; len--, pos++)
+            page[pos] = page[pos - back];
+        }
+    }
+  if (pos != PGSIZE)
+    PANIC ("zswap: page decompressed to %zu bytes", pos);
+}
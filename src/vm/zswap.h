@@ -0,0 +1,22 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* A page's contents kept in memory by zswap. */
+struct zswap_entry
+  {
+    size_t chunk;               /* First arena chunk, if SIZE > 0. */
+    size_t size;                /* Compressed size, or 0 if same-filled. */
+    uint32_t fill;              /* Repeated word, if SIZE is 0. */
+  };
+
+void zswap_init (void);
+bool zswap_store (const void *page, struct zswap_entry *);
+void zswap_load (const struct zswap_entry *, void *page);
+void zswap_free (struct zswap_entry *);
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */